@@ -70,7 +70,8 @@ struct channel
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
-    struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct semaphore completion_wait;   /* Up'd by completion work. */
+    struct intr_work completion;        /* Queued by interrupt handler. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -96,6 +97,7 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static intr_work_func complete_command;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -126,6 +128,7 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      intr_work_init (&c->completion, complete_command, c);
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -514,7 +517,7 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
-            sema_up (&c->completion_wait);      /* Wake up waiter. */
+            intr_defer (&c->completion);        /* Wake up waiter. */
           }
         else
           printf ("%s: unexpected interrupt\n", c->name);
@@ -524,4 +527,11 @@ interrupt_handler (struct intr_frame *f)
   NOT_REACHED ();
 }
 
-
+/* Wakes up the thread waiting for the command on channel C_ to
+   complete.  Deferred by interrupt_handler(). */
+static void
+complete_command (void *c_) 
+{
+  struct channel *c = c_;
+  sema_up (&c->completion_wait);
+}
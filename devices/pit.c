@@ -11,8 +11,13 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* Read-back command: latch the count and the status of a
+   channel, selected by OR'ing in PIT_READ_BACK_CHANNEL. */
+#define PIT_READ_BACK                 0xc0
+#define PIT_READ_BACK_CHANNEL(CHANNEL) (2 << (CHANNEL))
+
+/* Status byte bit that mirrors the channel's output pin. */
+#define PIT_STATUS_OUT                0x80
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -81,3 +86,49 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts a single countdown of COUNT PIT cycles on CHANNEL, in
+   mode 0 ("interrupt on terminal count"): the output goes low
+   now and rises once, after COUNT cycles, which raises a single
+   interrupt on channel 0.  A COUNT of 0 means 65536.  The channel
+   stays in this mode until pit_configure_channel() is called. */
+void
+pit_start_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current counter value of CHANNEL, using the
+   read-back command so that the output pin can be sampled
+   atomically with it.  For a channel started with
+   pit_start_oneshot(), *EXPIRED is set to true if the countdown
+   has already reached zero, in which case the returned count is
+   meaningless. */
+uint16_t
+pit_read_count (int channel, bool *expired)
+{
+  enum intr_level old_level;
+  uint8_t status;
+  uint16_t count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, PIT_READ_BACK | PIT_READ_BACK_CHANNEL (channel));
+  status = inb (PIT_PORT_COUNTER (channel));
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  if (expired != NULL)
+    *expired = (status & PIT_STATUS_OUT) != 0;
+  return count;
+}
@@ -4,11 +4,19 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+#ifdef VM
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
@@ -130,6 +138,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  intr_print_stats ();
+  palloc_print_stats ();
+  kmem_print_stats ();
+#ifdef LOCKSTAT
+  lockstat_print_stats ();
+#endif
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -138,4 +152,8 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  page_print_stats ();
+  swap_print_stats ();
+#endif
 }
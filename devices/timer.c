@@ -20,15 +20,67 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* PIT cycles in one timer tick. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second.  If true, the idle thread stops the periodic tick and
+   programs a single interrupt for the next sleeper's deadline.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Tick boundaries covered by the running one-shot countdown,
+   the last of them being the one at which it expires, or 0 while
+   the timer is periodic.  A one-shot always expires on a tick
+   boundary. */
+static unsigned oneshot_ticks;
+
+/* Ticks accounted without a timer interrupt, because the timer
+   was stopped in tickless idle. */
+static int64_t tickless_ticks;
+
+/* Deferred wakeup of sleeping threads, queued by the timer
+   interrupt whenever a sleeper is due.  Each run wakes at most
+   WAKE_BATCH threads, so that a crowd of sleepers due on the same
+   tick cannot keep interrupts off for long. */
+static struct intr_work wakeup_work;
+#define WAKE_BATCH 8
+
 /* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
+   Initialized by timer_calibrate() if there is no TSC. */
 static unsigned loops_per_tick;
 
+/* Time stamp counter clock source.  timer_calibrate() counts the
+   TSC cycles in TSC_CALIBRATE_TICKS timer ticks, once, and from
+   then on timer_now_ns() and the sub-tick sleeps and delays read
+   the TSC instead of counting ticks or loops.  Cycles convert to
+   nanoseconds as (CYCLES * tsc_mult) >> tsc_shift. */
+#define TSC_CALIBRATE_TICKS 5
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+#define CPUID_TSC (1u << 4)             /* CPUID.1:EDX, TSC present. */
+static uint64_t tsc_hz;                 /* Cycles per second, 0 if none. */
+static uint32_t tsc_mult;               /* Cycles to ns multiplier. */
+static int tsc_shift;                   /* Cycles to ns shift. */
+static uint64_t tsc_base;               /* TSC at tick tsc_base_ticks. */
+static int64_t tsc_base_ticks;          /* Tick at which TSC read tsc_base. */
+
 static intr_handler_func timer_interrupt;
+static intr_work_func wake_sleepers;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool tsc_calibrate (void);
+static int64_t tsc_to_ns (uint64_t cycles);
+
+/* Returns the time stamp counter. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -36,10 +88,12 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  intr_work_init (&wakeup_work, wake_sleepers, NULL);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC, or loops_per_tick if the CPU has no TSC,
+   used to implement brief delays and timer_now_ns(). */
 void
 timer_calibrate (void) 
 {
@@ -48,6 +102,12 @@ timer_calibrate (void)
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
+  if (tsc_calibrate ()) 
+    {
+      printf ("%'"PRIu64" TSC cycles/s.\n", tsc_hz);
+      return;
+    }
+
   /* Approximate loops_per_tick as the largest power-of-two
      still less than one timer tick. */
   loops_per_tick = 1u << 10;
@@ -84,6 +144,18 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  The
+   result never decreases.  Its resolution is one TSC cycle, or
+   one timer tick if the CPU has no TSC or timer_calibrate() has
+   not run yet. */
+int64_t
+timer_now_ns (void) 
+{
+  if (tsc_hz == 0)
+    return timer_ticks () * NS_PER_TICK;
+  return tsc_base_ticks * NS_PER_TICK + tsc_to_ns (rdtsc () - tsc_base);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -156,11 +228,101 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic
+   tick by a single interrupt at the earliest sleeper's deadline,
+   or as far away as the PIT allows.  Whatever interrupt wakes
+   the CPU up calls timer_idle_exit(). */
+void
+timer_idle_enter (void) 
+{
+  int64_t delta;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Nothing to do unless tickless, or if the rest of a tick cut
+     short by timer_idle_exit() is still counting down. */
+  if (!timer_tickless || oneshot_ticks != 0)
+    return;
+
+  /* The PIT counter is 16 bits wide. */
+  delta = thread_next_wakeup () - ticks;
+  if (delta > UINT16_MAX / PIT_COUNTS_PER_TICK)
+    delta = UINT16_MAX / PIT_COUNTS_PER_TICK;
+  if (delta <= 1)
+    return;
+
+  oneshot_ticks = delta;
+  pit_start_oneshot (0, oneshot_ticks * PIT_COUNTS_PER_TICK);
+}
+
+/* Called at the start of every external interrupt handler.  If
+   the timer was stopped by timer_idle_enter(), accounts for the
+   ticks that went by since then, as if the periodic tick had
+   been running, and restarts the periodic tick.  If the interrupt
+   came in the middle of a tick, the periodic tick is restarted
+   only once the rest of that tick has been counted down by a
+   one-shot, so that its interrupt falls where the periodic one
+   would have. */
+void
+timer_idle_exit (void) 
+{
+  unsigned elapsed, left;
+  bool expired;
+  uint16_t count;
+
+  ASSERT (intr_context ());
+
+  if (oneshot_ticks == 0)
+    return;
+
+  count = pit_read_count (0, &expired);
+  if (expired)
+    {
+      /* The one-shot interrupt, which is either being handled
+         right now or is pending, accounts for the last tick. */
+      elapsed = oneshot_ticks - 1;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  else
+    {
+      /* COUNT cycles are left to the deadline, so the boundaries
+         still ahead are DIV_ROUND_UP (COUNT, PIT_COUNTS_PER_TICK),
+         the next one LEFT cycles away. */
+      left = (count - 1) % PIT_COUNTS_PER_TICK + 1;
+      elapsed = oneshot_ticks - DIV_ROUND_UP (count, PIT_COUNTS_PER_TICK);
+      if (left < PIT_COUNTS_PER_TICK)
+        {
+          /* Its interrupt restarts the periodic tick. */
+          oneshot_ticks = 1;
+          pit_start_oneshot (0, left);
+        }
+      else
+        {
+          oneshot_ticks = 0;
+          pit_configure_channel (0, 2, TIMER_FREQ);
+        }
+    }
+
+  /* Nobody is due before the deadline, so no sleeper needs to
+     wake up, but the scheduler still sees every tick. */
+  tickless_ticks += elapsed;
+  while (elapsed-- > 0)
+    {
+      ticks++;
+      thread_tick ();
+    }
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" ticks elapsed in tickless idle\n",
+            tickless_ticks);
 }
 
 /* Timer interrupt handler. */
@@ -170,7 +332,17 @@ timer_interrupt (struct intr_frame *args UNUSED)
   ticks++;
  
   thread_tick ();
-  awake_sleeping_thread(ticks);
+  if (thread_next_wakeup () <= ticks)
+    intr_defer (&wakeup_work);
+}
+
+/* Wakes up a batch of sleeping threads that are due, and queues
+   itself again if that did not exhaust them. */
+static void
+wake_sleepers (void *aux UNUSED) 
+{
+  if (awake_sleeping_thread (ticks, WAKE_BATCH))
+    intr_defer (&wakeup_work);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -228,8 +400,8 @@ real_time_sleep (int64_t num, int32_t denom)
     }
   else 
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
+      /* Otherwise, use a busy-wait loop, on the TSC if there is
+         one, for more accurate sub-tick timing. */
       real_time_delay (num, denom); 
     }
 }
@@ -238,9 +410,68 @@ real_time_sleep (int64_t num, int32_t denom)
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
+  if (tsc_hz != 0) 
+    {
+      uint64_t start = rdtsc ();
+      uint64_t cycles = num * tsc_hz / denom;
+
+      while (rdtsc () - start < cycles)
+        asm volatile ("pause");
+      return;
+    }
+
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
 
+/* If the CPU has a time stamp counter, measures its frequency
+   against the timer tick, sets up the clock source, and returns
+   true.  Otherwise returns false. */
+static bool
+tsc_calibrate (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint64_t start_tsc, end_tsc;
+  int64_t start, end;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if ((edx & CPUID_TSC) == 0)
+    return false;
+
+  /* Count cycles from one tick boundary to another. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  start_tsc = rdtsc ();
+  start = ticks;
+  while ((end = ticks) - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  end_tsc = rdtsc ();
+
+  /* Pick the largest shift for which the multiplier still fits
+     in 32 bits, for the best precision. */
+  tsc_hz = (end_tsc - start_tsc) * TIMER_FREQ / (end - start);
+  for (tsc_shift = 32; tsc_shift > 0; tsc_shift--)
+    if ((1000ULL * 1000 * 1000 << tsc_shift) / tsc_hz <= UINT32_MAX)
+      break;
+  tsc_mult = (1000ULL * 1000 * 1000 << tsc_shift) / tsc_hz;
+
+  tsc_base = end_tsc;
+  tsc_base_ticks = end;
+  return true;
+}
+
+/* Converts CYCLES of the TSC into nanoseconds.  The 96-bit
+   product of CYCLES and tsc_mult is formed from two 64-bit
+   halves, since tsc_shift is at most 32. */
+static int64_t
+tsc_to_ns (uint64_t cycles) 
+{
+  uint64_t hi = (cycles >> 32) * tsc_mult;
+  uint64_t lo = (cycles & UINT32_MAX) * tsc_mult;
+
+  return (hi << (32 - tsc_shift)) + (lo >> tsc_shift);
+}
+
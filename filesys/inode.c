@@ -6,6 +6,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -37,6 +39,8 @@ struct inode
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    struct rwlock rwlock;               /* Guards the members above except
+                                           elem and sector. */
   };
 
 /* Returns the block device sector that contains byte offset POS
@@ -57,11 +61,57 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Guards open_inodes.  Lookups, by far the common case, only
+   need shared access.  Acquire it before any inode's rwlock. */
+static struct rwlock open_inodes_lock;
+
+/* Allocates in-memory inodes.  An inode's rwlock is initialized
+   once, by inode_ctor(), and is free whenever the inode is. */
+static struct kmem_cache inode_cache;
+
+static void
+inode_ctor (void *inode_) 
+{
+  struct inode *inode = inode_;
+  rwlock_init (&inode->rwlock);
+}
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), inode_ctor);
+}
+
+/* Returns the open inode for SECTOR, reopening it, or a null
+   pointer if SECTOR is not open.  An inode whose last opener has
+   closed it is being torn down by inode_close() and is skipped.
+   The caller must hold open_inodes_lock. */
+static struct inode *
+inode_lookup (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        {
+          bool open;
+
+          rwlock_acquire_write (&inode->rwlock);
+          open = inode->open_cnt > 0;
+          if (open)
+            inode->open_cnt++;
+          rwlock_release_write (&inode->rwlock);
+          if (open)
+            return inode;
+        }
+    }
+  return NULL;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,25 +161,26 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = inode_lookup (sector);
+  rwlock_release_read (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  /* Check again with exclusive access, since another thread may
+     have opened it in the meantime. */
+  rwlock_acquire_write (&open_inodes_lock);
+  inode = inode_lookup (sector);
+  if (inode != NULL)
+    goto done;
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
-    return NULL;
+    goto done;
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -138,6 +189,9 @@ inode_open (block_sector_t sector)
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+
+ done:
+  rwlock_release_write (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +200,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      rwlock_acquire_write (&inode->rwlock);
+      inode->open_cnt++;
+      rwlock_release_write (&inode->rwlock);
+    }
   return inode;
 }
 
@@ -167,22 +225,31 @@ inode_close (struct inode *inode)
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* Release resources if this was the last opener.  Once
+     open_cnt drops to 0, inode_lookup() no longer reopens INODE,
+     so nobody else can get at it. */
+  rwlock_acquire_write (&inode->rwlock);
+  if (--inode->open_cnt > 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
-        {
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
-        }
+      rwlock_release_write (&inode->rwlock);
+      return;
+    }
+  rwlock_release_write (&inode->rwlock);
 
-      free (inode); 
+  /* Remove from inode list. */
+  rwlock_acquire_write (&open_inodes_lock);
+  list_remove (&inode->elem);
+  rwlock_release_write (&open_inodes_lock);
+
+  /* Deallocate blocks if removed. */
+  if (inode->removed) 
+    {
+      free_map_release (inode->sector, 1);
+      free_map_release (inode->data.start,
+                        bytes_to_sectors (inode->data.length)); 
     }
+
+  kmem_cache_free (&inode_cache, inode); 
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,7 +258,9 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  rwlock_acquire_write (&inode->rwlock);
   inode->removed = true;
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -203,6 +272,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
+  off_t length = inode_length (inode);
 
   while (size > 0) 
     {
@@ -211,7 +281,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -261,8 +331,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
-
-  if (inode->deny_write_cnt)
+  bool denied;
+  off_t length;
+
+  rwlock_acquire_read (&inode->rwlock);
+  denied = inode->deny_write_cnt > 0;
+  length = inode->data.length;
+  rwlock_release_read (&inode->rwlock);
+  if (denied)
     return 0;
 
   while (size > 0) 
@@ -272,7 +348,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -322,8 +398,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,14 +410,23 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  /* The lock is not part of INODE's logical state. */
+  struct rwlock *rwlock = (struct rwlock *) &inode->rwlock;
+  off_t length;
+
+  rwlock_acquire_read (rwlock);
+  length = inode->data.length;
+  rwlock_release_read (rwlock);
+  return length;
 }
@@ -46,6 +46,34 @@ bit_mask (size_t bit_idx)
   return (elem_type) 1 << (bit_idx % ELEM_BITS);
 }
 
+/* Returns an elem_type in which the bits that represent bitmap
+   bits START through END, exclusive, within the element that
+   contains bit START are turned on.  END must be in the same
+   element, or be the first bit of the next one. */
+static inline elem_type
+range_mask (size_t start, size_t end) 
+{
+  elem_type mask = (elem_type) -1 << (start % ELEM_BITS);
+  if (end - start + start % ELEM_BITS < ELEM_BITS)
+    mask &= ((elem_type) 1 << (end % ELEM_BITS)) - 1;
+  return mask;
+}
+
+/* Returns the number of 1-bits in X. */
+static inline unsigned
+count_ones (elem_type x) 
+{
+  /* Add up adjacent fields of 1, 2, then 4 bits, then sum the
+     bytes with a multiply.  __builtin_popcount() would do, but it
+     calls into libgcc, which the kernel does not link. */
+  const elem_type ones = (elem_type) -1;
+
+  x = x - ((x >> 1) & (ones / 3));
+  x = (x & (ones / 15 * 3)) + ((x >> 2) & (ones / 15 * 3));
+  x = (x + (x >> 4)) & (ones / 255 * 15);
+  return (x * (ones / 255)) >> (ELEM_BITS - CHAR_BIT);
+}
+
 /* Returns the number of elements required for BIT_CNT bits. */
 static inline size_t
 elem_cnt (size_t bit_cnt)
@@ -68,6 +96,33 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Examines a whole element at a time, skipping elements in which
+   no bit is set to VALUE, and locates the bit with `bsf'. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx;
+  elem_type bits;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  bits = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (bits == 0) 
+    {
+      if (++idx >= elem_cnt (end))
+        return end;
+      bits = b->bits[idx] ^ flip;
+    }
+
+  start = idx * ELEM_BITS + __builtin_ctzl (bits);
+  return start < end ? start : end;
+}
 
 /* Creation and destruction. */
 
@@ -217,14 +272,29 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Each element is updated with a single OR or AND, which keeps
+     the atomicity of bitmap_mark() and bitmap_reset(). */
+  while (start < end) 
+    {
+      size_t next = (elem_idx (start) + 1) * ELEM_BITS;
+      elem_type mask;
+      elem_type *elem = &b->bits[elem_idx (start)];
+
+      if (next > end)
+        next = end;
+      mask = range_mask (start, next);
+      if (value)
+        asm ("orl %1, %0" : "=m" (*elem) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (*elem) : "r" (~mask) : "cc");
+      start = next;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,17 +302,24 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t set_cnt = 0;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  while (start < end) 
+    {
+      size_t next = (elem_idx (start) + 1) * ELEM_BITS;
+
+      if (next > end)
+        next = end;
+      set_cnt += count_ones (b->bits[elem_idx (start)]
+                             & range_mask (start, next));
+      start = next;
+    }
+  return value ? set_cnt : cnt - set_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -250,16 +327,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -298,13 +370,23 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      /* Jump to the next bit set to VALUE, then past the first
+         bit set to !VALUE in the CNT bits that follow it, if any.
+         Every group starting in between would contain that bit. */
+      while ((i = find_bit (b, i, last + 1, value)) <= last) 
+        {
+          size_t end = find_bit (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end + 1;
+        }
     }
   return BITMAP_ERROR;
 }
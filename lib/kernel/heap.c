@@ -0,0 +1,224 @@
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void detach (struct heap_elem *);
+static struct heap_elem *parent (struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->next = elem->prev = NULL;
+  heap->root = meld (heap, heap->root, elem);
+  heap->size++;
+}
+
+/* Returns the least element in HEAP, without removing it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_min (struct heap *heap) 
+{
+  ASSERT (!heap_empty (heap));
+  return heap->root;
+}
+
+/* Removes the least element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) 
+{
+  struct heap_elem *min = heap_min (heap);
+
+  heap->root = merge_pairs (heap, min->child);
+  heap->size--;
+  return min;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    heap_pop (heap);
+  else
+    {
+      detach (elem);
+      heap->root = meld (heap, heap->root, merge_pairs (heap, elem->child));
+      heap->size--;
+    }
+}
+
+/* Restores the heap order after ELEM, which must be in HEAP,
+   became less than it was. */
+void
+heap_decrease (struct heap *heap, struct heap_elem *elem) 
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem != heap->root)
+    {
+      detach (elem);
+      heap->root = meld (heap, heap->root, elem);
+    }
+}
+
+/* Calls ACTION on each element of HEAP, in no particular order,
+   passing along AUX.  ACTION must neither add nor remove
+   elements, nor change their order.  The walk needs no extra
+   memory: it climbs back up through the `prev' pointers. */
+void
+heap_apply (struct heap *heap, heap_action_func *action, void *aux) 
+{
+  struct heap_elem *e;
+
+  ASSERT (heap != NULL);
+  ASSERT (action != NULL);
+
+  e = heap->root;
+  while (e != NULL) 
+    {
+      action (e, aux);
+      if (e->child != NULL)
+        e = e->child;
+      else
+        {
+          while (e != NULL && e->next == NULL)
+            e = parent (e);
+          if (e != NULL)
+            e = e->next;
+        }
+    }
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (struct heap *heap) 
+{
+  ASSERT (heap != NULL);
+  return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (struct heap *heap) 
+{
+  ASSERT (heap != NULL);
+  return heap->root == NULL;
+}
+
+/* Melds the heap-ordered trees rooted at A and B, either of
+   which may be null, and returns the root of the result.  The
+   root that loses becomes the leftmost child of the other.  The
+   sibling pointers of the winning root are left untouched. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (heap->less (b, a, heap->aux)) 
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of sibling trees starting at FIRST into a
+   single tree and returns its root, or a null pointer if FIRST
+   is null.  This is the usual two-pass pairing: trees are melded
+   in pairs from left to right, then the pairs are melded from
+   right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;       /* Melded pairs, in reverse. */
+  struct heap_elem *root = NULL;
+
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = first->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+
+      a = meld (heap, a, b);
+      a->next = pairs;
+      pairs = a;
+    }
+
+  while (pairs != NULL) 
+    {
+      struct heap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+
+  if (root != NULL)
+    root->next = root->prev = NULL;
+  return root;
+}
+
+/* Returns the parent of ELEM, or a null pointer if ELEM is a
+   root. */
+static struct heap_elem *
+parent (struct heap_elem *elem) 
+{
+  while (elem->prev != NULL && elem->prev->child != elem)
+    elem = elem->prev;
+  return elem->prev;
+}
+
+/* Unlinks ELEM, together with its subtree, from its parent and
+   siblings.  ELEM must not be a root. */
+static void
+detach (struct heap_elem *elem) 
+{
+  ASSERT (elem->prev != NULL);
+
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->next;
+  else
+    elem->prev->next = elem->next;
+  if (elem->next != NULL)
+    elem->next->prev = elem->prev;
+  elem->next = elem->prev = NULL;
+}
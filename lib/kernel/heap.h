@@ -0,0 +1,84 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Min-heap (priority queue).
+
+   This is a pairing heap.  Like the lists in list.h, it does not
+   use dynamically allocated memory: each structure that can be
+   in a heap embeds a struct heap_elem member, and heap_entry()
+   converts a struct heap_elem back into its enclosing structure.
+
+   The order is given by a heap_less_func supplied to
+   heap_init().  heap_min() returns the least element, so a heap
+   ordered by "greater than" hands out its greatest element
+   first.
+
+   Costs, amortized, for a heap of N elements:
+
+     - heap_push(), heap_min(): O(1).
+
+     - heap_pop(), heap_remove(): O(log N).
+
+     - heap_decrease(): O(log N).  It is cheap in practice, but
+       for pairing heaps its exact amortized cost is an open
+       problem; it is known to be Omega(log log N), so not O(1).
+
+   If the key of an element that is in a heap changes, the heap
+   must be told: heap_decrease() if the element moved toward the
+   front of the order, otherwise heap_remove() followed by
+   heap_push(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem 
+  {
+    struct heap_elem *child;    /* Leftmost child. */
+    struct heap_elem *next;     /* Next sibling. */
+    struct heap_elem *prev;     /* Previous sibling, or parent if
+                                   this is a leftmost child. */
+  };
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Performs some operation on heap element E, given auxiliary
+   data AUX. */
+typedef void heap_action_func (struct heap_elem *e, void *aux);
+
+/* Heap. */
+struct heap 
+  {
+    struct heap_elem *root;     /* Least element, or null. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child            \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_min (struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_decrease (struct heap *, struct heap_elem *);
+void heap_apply (struct heap *, heap_action_func *, void *aux);
+
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
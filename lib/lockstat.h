@@ -0,0 +1,21 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+#include <stdint.h>
+
+/* Contention statistics of the locks initialized at one
+   lock_init() call site, as collected by a kernel built with
+   LOCKSTAT defined.  Times are in timer ticks. */
+struct lockstat
+  {
+    char site[32];              /* "file:line" of the lock_init() call. */
+    unsigned locks;             /* # of locks initialized there. */
+    int64_t acquisitions;       /* # of times acquired. */
+    int64_t contended;          /* # of acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total time spent waiting. */
+    int64_t max_wait_ticks;     /* Longest single wait. */
+    int64_t hold_ticks;         /* Total time held. */
+    int64_t max_hold_ticks;     /* Longest single hold. */
+  };
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,40 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resources used by a thread, as returned by the rusage system
+   call.  CPU time is in timer ticks. */
+struct rusage
+  {
+    int64_t user_ticks;         /* Ticks spent running user code. */
+    int64_t kernel_ticks;       /* Ticks spent running kernel code. */
+    int64_t voluntary_switches; /* # of times it blocked. */
+    int64_t involuntary_switches; /* # of times it was preempted. */
+    int64_t code_faults;        /* Page faults that loaded code or data. */
+    int64_t stack_faults;       /* Page faults that allocated stack. */
+    int64_t swap_faults;        /* Page faults that read back swap. */
+    int64_t bytes_read;         /* Bytes read by the read system call. */
+    int64_t bytes_written;      /* Bytes written by the write system call. */
+  };
+
+/* Whose resources the rusage system call returns. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that were waited for. */
+
+/* Adds the counters in B to those in A. */
+static inline void
+rusage_add (struct rusage *a, const struct rusage *b) 
+{
+  a->user_ticks += b->user_ticks;
+  a->kernel_ticks += b->kernel_ticks;
+  a->voluntary_switches += b->voluntary_switches;
+  a->involuntary_switches += b->involuntary_switches;
+  a->code_faults += b->code_faults;
+  a->stack_faults += b->stack_faults;
+  a->swap_faults += b->swap_faults;
+  a->bytes_read += b->bytes_read;
+  a->bytes_written += b->bytes_written;
+}
+
+#endif /* lib/rusage.h */
@@ -1,5 +1,19 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block routines below move whole 32-bit words with the x86
+   string instructions, after copying bytes one at a time until
+   the destination is word-aligned, and finish with the few bytes
+   left over.  Blocks shorter than WORD_MIN bytes are not worth the
+   setup and go a byte at a time.
+
+   They rely on the direction flag being clear on entry, as the
+   i386 calling convention requires and intr_entry ensures. */
+#define WORD_MIN 16
+
+/* A word that may alias any other type, for memcmp(). */
+typedef uint32_t word_t __attribute__ ((may_alias));
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +26,21 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  if (size >= WORD_MIN) 
+    {
+      size_t head = -(uintptr_t) dst & (sizeof (word_t) - 1);
+      size_t words;
+
+      size -= head;
+      asm volatile ("rep movsb"
+                    : "+D" (dst), "+S" (src), "+c" (head) : : "memory");
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (size) : : "memory");
 
   return dst_;
 }
@@ -29,20 +56,42 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size)
+    return memcpy (dst_, src_, size);
+
+  /* DST overlaps the end of SRC, so copy backward, with the
+     direction flag set: first the bytes past the last aligned
+     word of DST, then whole words, then the bytes before them.
+     The flag is set and cleared within a single asm statement so
+     that no compiler-generated code runs with it set. */
+  dst += size - 1;
+  src += size - 1;
+  if (size >= WORD_MIN) 
     {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      size_t tail = ((uintptr_t) dst + 1) & (sizeof (word_t) - 1);
+      size_t words = (size - tail) / sizeof (word_t);
+      size_t head = (size - tail) % sizeof (word_t);
+
+      asm volatile ("std\n\t"
+                    "rep movsb\n\t"
+                    "subl $3, %%edi\n\t"
+                    "subl $3, %%esi\n\t"
+                    "movl %3, %%ecx\n\t"
+                    "rep movsl\n\t"
+                    "addl $3, %%edi\n\t"
+                    "addl $3, %%esi\n\t"
+                    "movl %4, %%ecx\n\t"
+                    "rep movsb\n\t"
+                    "cld"
+                    : "+D" (dst), "+S" (src), "+c" (tail)
+                    : "rm" (words), "rm" (head)
+                    : "memory", "cc");
     }
+  else
+    asm volatile ("std; rep movsb; cld"
+                  : "+D" (dst), "+S" (src), "+c" (size) : : "memory", "cc");
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +107,14 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte, if any. */
+  for (; size >= sizeof (word_t); size -= sizeof (word_t))
+    {
+      if (*(const word_t *) a != *(const word_t *) b)
+        break;
+      a += sizeof (word_t);
+      b += sizeof (word_t);
+    }
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -282,8 +339,22 @@ memset (void *dst_, int value, size_t size)
 
   ASSERT (dst != NULL || size == 0);
   
-  while (size-- > 0)
-    *dst++ = value;
+  if (size >= WORD_MIN) 
+    {
+      uint32_t word = (unsigned char) value * 0x01010101u;
+      size_t head = -(uintptr_t) dst & (sizeof (word_t) - 1);
+      size_t words;
+
+      size -= head;
+      asm volatile ("rep stosb"
+                    : "+D" (dst), "+c" (head) : "a" (word) : "memory");
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (word) : "memory");
+    }
+  asm volatile ("rep stosb"
+                : "+D" (dst), "+c" (size) : "a" (value) : "memory");
 
   return dst_;
 }
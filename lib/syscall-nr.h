@@ -28,7 +28,12 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Kernel statistics. */
+    SYS_LOCKSTAT,               /* Reads the lock contention statistics. */
+    SYS_CLOCK,                  /* Reads the monotonic clock. */
+    SYS_RUSAGE                  /* Reads resource usage. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -182,3 +182,29 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+lockstat (struct lockstat *top, int cnt)
+{
+  return syscall2 (SYS_LOCKSTAT, top, cnt);
+}
+
+int
+rusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_RUSAGE, who, usage);
+}
+
+/* Returns nanoseconds since boot.  The result comes back in
+   EDX:EAX, which none of the syscallN macros can express. */
+int64_t
+clock_ns (void) 
+{
+  int64_t ns;
+  asm volatile
+    ("pushl %[number]; int $0x30; addl $4, %%esp"
+       : "=A" (ns)
+       : [number] "i" (SYS_CLOCK)
+       : "memory");
+  return ns;
+}
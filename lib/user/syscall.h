@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,9 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Kernel statistics. */
+int lockstat (struct lockstat *, int cnt);
+int64_t clock_ns (void);
+int rusage (int who, struct rusage *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,56 @@
+/* Puts 40 threads of distinct priorities to sleep until the same
+   tick, more than the timer wakes up on a single interrupt
+   return, and checks that they all wake up and that the
+   higher-priority threads still run first. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 40
+
+static thread_func alarm_crowd_thread;
+static int64_t wake_time;
+static struct semaphore wait_sema;
+
+void
+test_alarm_crowd (void) 
+{
+  int i;
+  
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  wake_time = timer_ticks () + 5 * TIMER_FREQ;
+  sema_init (&wait_sema, 0);
+  
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      int priority = PRI_MIN + 1 + (i * 7) % THREAD_CNT;
+      char name[16];
+      snprintf (name, sizeof name, "priority %d", priority);
+      thread_create (name, priority, alarm_crowd_thread, NULL);
+    }
+
+  thread_set_priority (PRI_MIN);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&wait_sema);
+}
+
+static void
+alarm_crowd_thread (void *aux UNUSED) 
+{
+  /* WAKE_TIME is far enough away that every thread goes to sleep
+     well before it. */
+  timer_sleep (wake_time - timer_ticks ());
+
+  /* Print a message on wake-up. */
+  msg ("Thread %s woke up.", thread_name ());
+
+  sema_up (&wait_sema);
+}
@@ -0,0 +1,49 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-crowd) begin
+(alarm-crowd) Thread priority 40 woke up.
+(alarm-crowd) Thread priority 39 woke up.
+(alarm-crowd) Thread priority 38 woke up.
+(alarm-crowd) Thread priority 37 woke up.
+(alarm-crowd) Thread priority 36 woke up.
+(alarm-crowd) Thread priority 35 woke up.
+(alarm-crowd) Thread priority 34 woke up.
+(alarm-crowd) Thread priority 33 woke up.
+(alarm-crowd) Thread priority 32 woke up.
+(alarm-crowd) Thread priority 31 woke up.
+(alarm-crowd) Thread priority 30 woke up.
+(alarm-crowd) Thread priority 29 woke up.
+(alarm-crowd) Thread priority 28 woke up.
+(alarm-crowd) Thread priority 27 woke up.
+(alarm-crowd) Thread priority 26 woke up.
+(alarm-crowd) Thread priority 25 woke up.
+(alarm-crowd) Thread priority 24 woke up.
+(alarm-crowd) Thread priority 23 woke up.
+(alarm-crowd) Thread priority 22 woke up.
+(alarm-crowd) Thread priority 21 woke up.
+(alarm-crowd) Thread priority 20 woke up.
+(alarm-crowd) Thread priority 19 woke up.
+(alarm-crowd) Thread priority 18 woke up.
+(alarm-crowd) Thread priority 17 woke up.
+(alarm-crowd) Thread priority 16 woke up.
+(alarm-crowd) Thread priority 15 woke up.
+(alarm-crowd) Thread priority 14 woke up.
+(alarm-crowd) Thread priority 13 woke up.
+(alarm-crowd) Thread priority 12 woke up.
+(alarm-crowd) Thread priority 11 woke up.
+(alarm-crowd) Thread priority 10 woke up.
+(alarm-crowd) Thread priority 9 woke up.
+(alarm-crowd) Thread priority 8 woke up.
+(alarm-crowd) Thread priority 7 woke up.
+(alarm-crowd) Thread priority 6 woke up.
+(alarm-crowd) Thread priority 5 woke up.
+(alarm-crowd) Thread priority 4 woke up.
+(alarm-crowd) Thread priority 3 woke up.
+(alarm-crowd) Thread priority 2 woke up.
+(alarm-crowd) Thread priority 1 woke up.
+(alarm-crowd) end
+EOF
+pass;
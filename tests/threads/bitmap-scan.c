@@ -0,0 +1,169 @@
+/* Checks bitmap_count(), bitmap_contains(), bitmap_scan() and
+   bitmap_set_multiple() against straightforward bit-at-a-time
+   versions built on bitmap_test(), which is how the bitmap
+   library used to implement them, on random bitmaps of random
+   sizes and densities.
+
+   Then times a scan for the only free bit at the end of a large,
+   otherwise full bitmap, the case that hurts the free map on a
+   big disk, both ways.  The timings go to the console on lines
+   starting with "Benchmark:", which the checker ignores. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 500
+#define QUERY_CNT 100
+#define MAX_BITS 300
+#define BENCH_BITS (256 * 1024)
+
+static size_t slow_count (const struct bitmap *, size_t start, size_t cnt,
+                          bool);
+static bool slow_contains (const struct bitmap *, size_t start, size_t cnt,
+                           bool);
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool);
+static void benchmark (void);
+
+void
+test_bitmap_scan (void) 
+{
+  int round;
+
+  random_init (0);
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      size_t bit_cnt = random_ulong () % MAX_BITS;
+      unsigned density = random_ulong () % 4;
+      struct bitmap *b = bitmap_create (bit_cnt);
+      int query;
+      size_t i;
+
+      if (b == NULL)
+        fail ("bitmap_create(%zu) failed", bit_cnt);
+
+      /* Mostly clear, mostly set, mixed, or all set. */
+      for (i = 0; i < bit_cnt; i++)
+        bitmap_set (b, i, (density == 0 ? random_ulong () % 16 == 0
+                           : density == 1 ? random_ulong () % 16 != 0
+                           : density == 2 ? random_ulong () % 2
+                           : true));
+
+      for (query = 0; query < QUERY_CNT; query++) 
+        {
+          size_t start = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % (bit_cnt - start + 1);
+          size_t scan_cnt = random_ulong () % (bit_cnt + 2);
+          bool value = random_ulong () % 2;
+
+          if (bitmap_count (b, start, cnt, value)
+              != slow_count (b, start, cnt, value))
+            fail ("bitmap_count (%zu, %zu, %d) wrong in %zu-bit bitmap",
+                  start, cnt, value, bit_cnt);
+          if (bitmap_contains (b, start, cnt, value)
+              != slow_contains (b, start, cnt, value))
+            fail ("bitmap_contains (%zu, %zu, %d) wrong in %zu-bit bitmap",
+                  start, cnt, value, bit_cnt);
+          if (bitmap_scan (b, start, scan_cnt, value)
+              != slow_scan (b, start, scan_cnt, value))
+            fail ("bitmap_scan (%zu, %zu, %d) wrong in %zu-bit bitmap",
+                  start, scan_cnt, value, bit_cnt);
+
+          if (query % 10 == 0) 
+            {
+              size_t before = slow_count (b, 0, bit_cnt, true);
+              size_t inside = slow_count (b, start, cnt, true);
+
+              bitmap_set_multiple (b, start, cnt, value);
+              if (slow_count (b, start, cnt, value) != cnt
+                  || (slow_count (b, 0, bit_cnt, true)
+                      != before - inside + (value ? cnt : 0)))
+                fail ("bitmap_set_multiple (%zu, %zu, %d) wrong in "
+                      "%zu-bit bitmap", start, cnt, value, bit_cnt);
+            }
+        }
+      bitmap_destroy (b);
+    }
+  msg ("%d random bitmaps agree with bit-at-a-time results", ROUND_CNT);
+
+  benchmark ();
+  msg ("benchmark done");
+}
+
+/* Times the old and new ways of finding the last bit of a
+   BENCH_BITS-bit bitmap, the only one that is clear. */
+static void
+benchmark (void) 
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  int64_t start, slow_ns, fast_ns;
+  size_t slow_idx, fast_idx;
+
+  if (b == NULL)
+    fail ("bitmap_create(%d) failed", BENCH_BITS);
+  bitmap_set_all (b, true);
+  bitmap_reset (b, BENCH_BITS - 1);
+
+  start = timer_now_ns ();
+  slow_idx = slow_scan (b, 0, 1, false);
+  slow_ns = timer_now_ns () - start;
+
+  start = timer_now_ns ();
+  fast_idx = bitmap_scan (b, 0, 1, false);
+  fast_ns = timer_now_ns () - start;
+
+  if (slow_idx != BENCH_BITS - 1 || fast_idx != BENCH_BITS - 1)
+    fail ("benchmark scan found bit %zu, %zu instead of %d",
+          slow_idx, fast_idx, BENCH_BITS - 1);
+  printf ("Benchmark: scanning %d bits: %lld ns bit at a time, "
+          "%lld ns word at a time\n", BENCH_BITS, slow_ns, fast_ns);
+  bitmap_destroy (b);
+}
+
+/* Returns the number of bits in B between START and START + CNT,
+   exclusive, that are set to VALUE, one bit at a time. */
+static size_t
+slow_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i, value_cnt = 0;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      value_cnt++;
+  return value_cnt;
+}
+
+/* Returns true if any bit in B between START and START + CNT,
+   exclusive, is set to VALUE, one bit at a time. */
+static bool
+slow_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (b, start + i) == value)
+      return true;
+  return false;
+}
+
+/* Returns the start of the first group of CNT bits in B at or
+   after START that are all set to VALUE, or BITMAP_ERROR,
+   testing every candidate position one bit at a time. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  if (cnt <= bitmap_size (b)) 
+    {
+      size_t last = bitmap_size (b) - cnt;
+      size_t i;
+
+      for (i = start; i <= last; i++)
+        if (!slow_contains (b, i, cnt, !value))
+          return i;
+    }
+  return BITMAP_ERROR;
+}
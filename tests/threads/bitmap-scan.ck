@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^Benchmark: /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(bitmap-scan) begin
+(bitmap-scan) 500 random bitmaps agree with bit-at-a-time results
+(bitmap-scan) benchmark done
+(bitmap-scan) end
+EOF
+pass;
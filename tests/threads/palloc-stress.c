@@ -0,0 +1,105 @@
+/* Stresses the page allocator with a random mix of allocations
+   of 1 to 16 pages and frees, checking that no two live blocks
+   overlap.  Once everything is freed again, the largest block
+   that could be allocated at the start must be available again,
+   which requires every freed block to have been merged back. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define SLOT_CNT 64
+#define ROUND_CNT 4000
+
+static struct
+  {
+    unsigned char *pages;       /* First page, or NULL if unused. */
+    size_t page_cnt;            /* Number of pages. */
+  }
+slots[SLOT_CNT];
+
+static size_t largest_block (void);
+static void check_slot (int slot);
+
+void
+test_palloc_stress (void) 
+{
+  size_t largest;
+  int round, i;
+
+  random_init (0);
+  largest = largest_block ();
+  msg ("largest free block found");
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+
+      if (slots[slot].pages != NULL) 
+        {
+          check_slot (slot);
+          palloc_free_multiple (slots[slot].pages, slots[slot].page_cnt);
+          slots[slot].pages = NULL;
+        }
+      else 
+        {
+          size_t page_cnt = random_ulong () % 16 + 1;
+          unsigned char *pages = palloc_get_multiple (0, page_cnt);
+          size_t j;
+
+          if (pages == NULL)
+            continue;
+          for (j = 0; j < page_cnt; j++)
+            memset (pages + j * PGSIZE, slot, PGSIZE);
+          slots[slot].pages = pages;
+          slots[slot].page_cnt = page_cnt;
+        }
+    }
+  msg ("%d rounds of mixed allocations done", ROUND_CNT);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL) 
+      {
+        check_slot (i);
+        palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+        slots[i].pages = NULL;
+      }
+
+  if (largest_block () < largest)
+    fail ("free memory did not coalesce");
+  msg ("free memory coalesced");
+}
+
+/* Returns the number of pages in the largest power-of-two block
+   that can be allocated from the kernel pool right now. */
+static size_t
+largest_block (void) 
+{
+  size_t page_cnt;
+
+  for (page_cnt = 1024; page_cnt > 0; page_cnt /= 2) 
+    {
+      void *pages = palloc_get_multiple (0, page_cnt);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, page_cnt);
+          return page_cnt;
+        }
+    }
+  return 0;
+}
+
+/* Verifies that nothing overwrote the block in SLOT, which was
+   filled with bytes equal to SLOT. */
+static void
+check_slot (int slot) 
+{
+  size_t ofs;
+
+  for (ofs = 0; ofs < slots[slot].page_cnt * PGSIZE; ofs += PGSIZE / 4)
+    if (slots[slot].pages[ofs] != slot)
+      fail ("block in slot %d overwritten at offset %zu", slot, ofs);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-stress) begin
+(palloc-stress) largest free block found
+(palloc-stress) 4000 rounds of mixed allocations done
+(palloc-stress) free memory coalesced
+(palloc-stress) end
+EOF
+pass;
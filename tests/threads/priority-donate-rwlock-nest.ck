@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock-nest) begin
+(priority-donate-rwlock-nest) Low thread should have priority 32.  Actual priority: 32.
+(priority-donate-rwlock-nest) Low thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwlock-nest) Medium thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwlock-nest) Medium thread got the rwlock.
+(priority-donate-rwlock-nest) High thread got the lock.
+(priority-donate-rwlock-nest) High thread finished.
+(priority-donate-rwlock-nest) High thread should have just finished.
+(priority-donate-rwlock-nest) Middle thread finished.
+(priority-donate-rwlock-nest) Medium thread should just have finished.
+(priority-donate-rwlock-nest) Low thread should have priority 31.  Actual priority: 31.
+(priority-donate-rwlock-nest) end
+EOF
+pass;
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-rwlock) begin
+(priority-donate-rwlock) This thread should have priority 33.  Actual priority: 33.
+(priority-donate-rwlock) This thread should have priority 34.  Actual priority: 34.
+(priority-donate-rwlock) writer: got the lock
+(priority-donate-rwlock) reader: got the lock
+(priority-donate-rwlock) reader: done
+(priority-donate-rwlock) writer: done
+(priority-donate-rwlock) writer, reader must already have finished.
+(priority-donate-rwlock) This should be the last line before finishing this test.
+(priority-donate-rwlock) end
+EOF
+pass;
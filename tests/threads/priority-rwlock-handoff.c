@@ -0,0 +1,50 @@
+/* The main thread acquires a reader-writer lock for reading, and
+   two writers of the same priority queue up behind it.  When the
+   main thread releases the lock, it must go to the first writer
+   right away: the main thread must not be able to take it back
+   for reading, and the writers must get it in the order they
+   asked for it, before the main thread's next read. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+
+void
+test_priority_rwlock_handoff (void) 
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer 1", PRI_DEFAULT, writer_thread_func, &rwlock);
+  thread_create ("writer 2", PRI_DEFAULT, writer_thread_func, &rwlock);
+  thread_yield ();
+
+  rwlock_release_read (&rwlock);
+  msg ("main: try_acquire_read %s.",
+       rwlock_try_acquire_read (&rwlock) ? "succeeded" : "failed");
+  rwlock_acquire_read (&rwlock);
+  msg ("main: got the lock");
+  rwlock_release_read (&rwlock);
+}
+
+static void
+writer_thread_func (void *rwlock_) 
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("%s: got the lock", thread_name ());
+  rwlock_release_write (rwlock);
+  msg ("%s: done", thread_name ());
+}
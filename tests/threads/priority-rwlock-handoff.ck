@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock-handoff) begin
+(priority-rwlock-handoff) main: try_acquire_read failed.
+(priority-rwlock-handoff) writer 1: got the lock
+(priority-rwlock-handoff) writer 1: done
+(priority-rwlock-handoff) writer 2: got the lock
+(priority-rwlock-handoff) writer 2: done
+(priority-rwlock-handoff) main: got the lock
+(priority-rwlock-handoff) end
+EOF
+pass;
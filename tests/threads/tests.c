@@ -15,6 +15,7 @@ static const struct test tests[] =
     {"alarm-multiple", test_alarm_multiple},
     {"alarm-simultaneous", test_alarm_simultaneous},
     {"alarm-priority", test_alarm_priority},
+    {"alarm-crowd", test_alarm_crowd},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
     {"priority-change", test_priority_change},
@@ -25,6 +26,9 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-rwlock", test_priority_donate_rwlock},
+    {"priority-donate-rwlock-nest", test_priority_donate_rwlock_nest},
+    {"priority-rwlock-handoff", test_priority_rwlock_handoff},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +42,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"palloc-stress", test_palloc_stress},
+    {"bitmap-scan", test_bitmap_scan},
   };
 
 static const char *test_name;
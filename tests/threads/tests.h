@@ -9,6 +9,7 @@ extern test_func test_alarm_single;
 extern test_func test_alarm_multiple;
 extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
+extern test_func test_alarm_crowd;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
 extern test_func test_priority_change;
@@ -19,6 +20,9 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_rwlock;
+extern test_func test_priority_donate_rwlock_nest;
+extern test_func test_priority_rwlock_handoff;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +36,8 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_palloc_stress;
+extern test_func test_bitmap_scan;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
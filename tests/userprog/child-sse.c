@@ -0,0 +1,29 @@
+/* Child process run by sse-independent test.
+   Loads a pattern into %xmm0, spins long enough to be preempted,
+   and checks that the pattern is still there. */
+
+#include <string.h>
+#include "tests/lib.h"
+
+int
+main (void) 
+{
+  static const char pattern[16] = "child's pattern!";
+  char result[16];
+  int i;
+
+  test_name = "child-sse";
+
+  asm volatile ("movups %0, %%xmm0" : : "m" (pattern));
+  for (i = 0; i < 10000000; i++)
+    asm volatile ("" : : : "memory");
+  asm volatile ("movups %%xmm0, %0" : "=m" (result));
+
+  if (memcmp (result, pattern, sizeof result))
+    {
+      msg ("%%xmm0 was clobbered");
+      return 1;
+    }
+  msg ("%%xmm0 intact");
+  return 0;
+}
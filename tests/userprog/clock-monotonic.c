@@ -0,0 +1,28 @@
+/* Reads the monotonic clock many times and verifies that it
+   never goes backward, then busy-waits until it has advanced by
+   a millisecond, which must happen eventually. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int64_t start, prev, now;
+  int i;
+
+  start = prev = clock_ns ();
+  for (i = 0; i < 10000; i++) 
+    {
+      now = clock_ns ();
+      if (now < prev)
+        fail ("clock went backward from %lld ns to %lld ns", prev, now);
+      prev = now;
+    }
+  msg ("clock never went backward");
+
+  while (clock_ns () - start < 1000 * 1000)
+    continue;
+  msg ("clock advanced by 1 ms");
+}
@@ -0,0 +1,41 @@
+/* Checks that the rusage system call counts the bytes moved by
+   read and write, that a waited-for child's usage is added to
+   RUSAGE_CHILDREN, and that any other WHO is rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[100];
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  int fd;
+
+  CHECK (create ("data", sizeof buf), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  rusage (RUSAGE_SELF, &before);
+  write (fd, buf, sizeof buf);
+  seek (fd, 0);
+  read (fd, buf, sizeof buf);
+  rusage (RUSAGE_SELF, &after);
+  if (after.bytes_written - before.bytes_written != sizeof buf)
+    fail ("wrote %d bytes, counted %lld", (int) sizeof buf,
+          after.bytes_written - before.bytes_written);
+  if (after.bytes_read - before.bytes_read != sizeof buf)
+    fail ("read %d bytes, counted %lld", (int) sizeof buf,
+          after.bytes_read - before.bytes_read);
+  msg ("bytes read and written counted");
+
+  rusage (RUSAGE_CHILDREN, &before);
+  wait (exec ("child-simple"));
+  rusage (RUSAGE_CHILDREN, &after);
+  if (after.bytes_written <= before.bytes_written)
+    fail ("child's console output not counted");
+  msg ("child's usage counted");
+
+  CHECK (rusage (1, &after) == -1, "rusage (1) must fail");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rusage) begin
+(rusage) create "data"
+(rusage) open "data"
+(rusage) bytes read and written counted
+(child-simple) run
+child-simple: exit(81)
+(rusage) child's usage counted
+(rusage) rusage (1) must fail
+(rusage) end
+rusage: exit(0)
+EOF
+pass;
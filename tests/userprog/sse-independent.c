@@ -0,0 +1,25 @@
+/* Loads a pattern into %xmm0, then runs a child process that
+   loads a different pattern into its own %xmm0 and checks that
+   it survives a while of running.  Afterward, the parent's
+   pattern must still be in %xmm0: each process has its own SSE
+   state. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char pattern[16] = "parent's pattern";
+  char result[16];
+
+  asm volatile ("movups %0, %%xmm0" : : "m" (pattern));
+  CHECK (wait (exec ("child-sse")) == 0, "wait (exec (\"child-sse\"))");
+  asm volatile ("movups %%xmm0, %0" : "=m" (result));
+
+  if (memcmp (result, pattern, sizeof result))
+    fail ("%%xmm0 was clobbered");
+  msg ("%%xmm0 intact");
+}
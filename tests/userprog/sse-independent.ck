@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sse-independent) begin
+(child-sse) %xmm0 intact
+child-sse: exit(0)
+(sse-independent) wait (exec ("child-sse"))
+(sse-independent) %xmm0 intact
+(sse-independent) end
+sse-independent: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Touches each page of a large zero-initialized buffer once and
+   reports the average time per page fault, as page-linear's
+   first pass would see it.  Not a graded test: run it with
+   "pintos -- run bench-fault", and again with "-zp=0" to compare
+   against faults that must zero their page on the spot. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void) 
+{
+  int64_t start, elapsed, slowest = 0;
+  size_t i;
+
+  start = clock_ns ();
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      int64_t before = clock_ns ();
+      int64_t took;
+
+      buf[i * PAGE_SIZE] = 1;
+      took = clock_ns () - before;
+      if (took > slowest)
+        slowest = took;
+    }
+  elapsed = clock_ns () - start;
+
+  for (i = 0; i < PAGE_CNT * PAGE_SIZE; i++)
+    if (buf[i] != (i % PAGE_SIZE == 0))
+      fail ("byte %zu is %d after fault", i, buf[i]);
+
+  msg ("%d faults in %lld ns: %lld ns per fault, slowest %lld ns",
+       PAGE_CNT, elapsed, elapsed / PAGE_CNT, slowest);
+}
@@ -0,0 +1,14 @@
+/* Runs bench_ptable() in a process with a 65536-page buffer. */
+
+#include "tests/vm/bench-ptable.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 65536
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void) 
+{
+  bench_ptable (buf, PAGE_CNT);
+}
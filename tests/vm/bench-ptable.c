@@ -0,0 +1,43 @@
+/* Times page faults, and system calls that check a user string,
+   in a process whose zero-initialized buffer BUF spans PAGE_CNT
+   pages, each of which has an entry in the supplementary page
+   table from the moment the process is loaded.  The
+   bench-ptable-1k, -16k and -64k programs run this with 1,024,
+   16,384 and 65,536 pages, so that comparing their results shows
+   how lookups scale with the size of the page table.  The larger
+   ones need more memory than the default, e.g. "pintos -m 32". */
+
+#include "tests/vm/bench-ptable.h"
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define PAGE_SIZE 4096
+#define FAULT_CNT 256           /* Pages to touch. */
+#define CALL_CNT 256            /* System calls to make. */
+
+void
+bench_ptable (char *buf, size_t page_cnt) 
+{
+  size_t stride = page_cnt / FAULT_CNT;
+  int64_t start, fault_ns, call_ns;
+  char *name = buf;
+  size_t i;
+
+  /* Touch FAULT_CNT pages spread over the whole buffer. */
+  start = clock_ns ();
+  for (i = 0; i < FAULT_CNT; i++)
+    buf[i * stride * PAGE_SIZE] = 1;
+  fault_ns = clock_ns () - start;
+
+  /* remove() checks each byte of its argument. */
+  name[0] = 'x';
+  name[1] = '\0';
+  start = clock_ns ();
+  for (i = 0; i < CALL_CNT; i++)
+    remove (name);
+  call_ns = clock_ns () - start;
+
+  msg ("%zu pages: %lld ns per fault, %lld ns per remove()",
+       page_cnt, fault_ns / FAULT_CNT, call_ns / CALL_CNT);
+}
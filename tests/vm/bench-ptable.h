@@ -0,0 +1,8 @@
+#ifndef TESTS_VM_BENCH_PTABLE
+#define TESTS_VM_BENCH_PTABLE 1
+
+#include <stddef.h>
+
+void bench_ptable (char *buf, size_t page_cnt);
+
+#endif /* tests/vm/bench-ptable.h */
@@ -0,0 +1,65 @@
+/* Times small reads of a file, first on their own and then while
+   child-linear processes page through swap, reporting the average
+   and the slowest read in each case.  With swap I/O serialized
+   behind the file system lock, reads stall for as long as a page
+   is being written to or read from the swap disk.  Not a graded
+   test: run it with
+     pintos -p tests/vm/sample.txt -a sample.txt
+            -p tests/vm/child-linear -a child-linear
+            -- -q run bench-swap-io */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 2
+#define READ_CNT 2000
+
+/* Reads the start of sample.txt READ_CNT times and stores the
+   average and slowest read times in *AVG_NS and *MAX_NS. */
+static void
+time_reads (int64_t *avg_ns, int64_t *max_ns) 
+{
+  char buf[512];
+  int64_t start, slowest = 0;
+  int fd, i;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  start = clock_ns ();
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      int64_t before = clock_ns ();
+      int64_t took;
+
+      seek (fd, 0);
+      if (read (fd, buf, sizeof buf) <= 0)
+        fail ("read \"sample.txt\" failed");
+      took = clock_ns () - before;
+      if (took > slowest)
+        slowest = took;
+    }
+  *avg_ns = (clock_ns () - start) / READ_CNT;
+  *max_ns = slowest;
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int64_t avg_ns, max_ns;
+  int i;
+
+  time_reads (&avg_ns, &max_ns);
+  msg ("alone: %lld ns per read, slowest %lld ns", avg_ns, max_ns);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK ((children[i] = exec ("child-linear")) != -1,
+           "exec \"child-linear\"");
+  time_reads (&avg_ns, &max_ns);
+  msg ("while paging: %lld ns per read, slowest %lld ns", avg_ns, max_ns);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+}
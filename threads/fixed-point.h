@@ -0,0 +1,60 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point real numbers, as used by the multi-level
+   feedback queue scheduler for recent_cpu and load_avg.
+
+   The integer part lives in the upper 17 bits (sign included) and
+   the fraction in the lower 14 bits, so a real number X is stored
+   as X * FP_F.  Products and quotients of two fixed-point values
+   are computed in 64 bits to avoid overflow. */
+typedef int fixed_point;
+
+#define FP_Q 14                         /* Number of fraction bits. */
+#define FP_F (1 << FP_Q)                /* Fixed-point 1. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_point
+fp_from_int (int n)
+{
+  return n * FP_F;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int
+fp_to_int (fixed_point x)
+{
+  return x / FP_F;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int
+fp_to_int_round (fixed_point x)
+{
+  return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+/* Returns X + N. */
+static inline fixed_point
+fp_add_int (fixed_point x, int n)
+{
+  return x + n * FP_F;
+}
+
+/* Returns X * Y. */
+static inline fixed_point
+fp_mul (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * y / FP_F;
+}
+
+/* Returns X / Y. */
+static inline fixed_point
+fp_div (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * FP_F / y;
+}
+
+#endif /* threads/fixed-point.h */
@@ -0,0 +1,206 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/syscall.h"
+#endif
+
+/* Lazy x87/SSE context switching.
+
+   Saving and restoring 512 bytes of FPU state on every thread
+   switch would tax every thread, although most of them, and the
+   kernel itself, never touch the FPU.  Instead the state stays in
+   the FPU registers, belonging to fpu_owner, and the switch only
+   sets CR0.TS.  The first FPU or SSE instruction another thread
+   executes then raises #NM, whose handler saves the owner's
+   state, loads the new thread's, and makes it the owner.
+
+   A thread's save area is allocated on its first FPU
+   instruction, so threads that never use the FPU cost nothing. */
+
+/* CR0 bits. */
+#define CR0_MP 0x00000002       /* Monitor coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) emulation. */
+#define CR0_TS 0x00000008       /* Task switched. */
+#define CR0_NE 0x00000020       /* Native FPU error reporting. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200     /* OS supports FXSAVE/FXRSTOR. */
+#define CR4_OSXMMEXCPT 0x00000400 /* OS handles #XF exceptions. */
+
+/* CPUID function 1 EDX bits. */
+#define CPUID_FXSR (1u << 24)   /* FXSAVE/FXRSTOR. */
+#define CPUID_SSE (1u << 25)    /* SSE. */
+
+/* An FXSAVE area. */
+struct fpu_area
+  {
+    uint8_t data[FPU_AREA_SIZE];
+  };
+
+/* True if the processor has an FPU we can switch lazily. */
+static bool fpu_enabled;
+
+/* Thread whose state is in the FPU registers, or a null pointer
+   if it belongs to no live thread. */
+static struct thread *fpu_owner;
+
+/* State right after FNINIT, with the default MXCSR, copied into
+   every new thread's save area. */
+static struct fpu_area fpu_initial_state __attribute__ ((aligned (16)));
+
+static intr_handler_func fpu_nm_handler;
+
+static inline uint32_t
+read_cr0 (void)
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+static inline void
+write_cr0 (uint32_t cr0)
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+}
+
+/* Returns the 16-byte-aligned save area of thread T, which must
+   have one. */
+static inline struct fpu_area *
+fpu_area (struct thread *t)
+{
+  return (struct fpu_area *) ROUND_UP ((uintptr_t) t->fpu, 16);
+}
+
+static inline void
+fxsave (struct fpu_area *area)
+{
+  asm volatile ("fxsave %0" : "=m" (*area));
+}
+
+static inline void
+fxrstor (const struct fpu_area *area)
+{
+  asm volatile ("fxrstor %0" : : "m" (*area));
+}
+
+/* Enables the FPU and SSE, if the processor supports FXSAVE, and
+   installs the #NM handler that switches FPU state lazily.
+   Otherwise leaves CR0.EM set, as start.S did, so that FPU
+   instructions keep trapping. */
+void
+fpu_init (void)
+{
+  uint32_t eax, ebx, ecx, edx, cr4;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if ((edx & CPUID_FXSR) == 0)
+    return;
+
+  write_cr0 ((read_cr0 () & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_OSFXSR;
+  if (edx & CPUID_SSE)
+    cr4 |= CR4_OSXMMEXCPT;
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+
+  asm volatile ("fninit");
+  fxsave (&fpu_initial_state);
+  fpu_enabled = true;
+
+  /* Nobody owns the FPU yet. */
+  write_cr0 (read_cr0 () | CR0_TS);
+
+  intr_register_int (7, 0, INTR_OFF, fpu_nm_handler,
+                     "#NM Device Not Available Exception");
+}
+
+/* Returns true if fpu_init() set up lazy FPU switching and took
+   over #NM, false if the processor cannot do FXSAVE. */
+bool
+fpu_available (void)
+{
+  return fpu_enabled;
+}
+
+/* Called on every switch to thread T.  Lets T use the FPU
+   directly if it still owns it, and makes it trap otherwise. */
+void
+fpu_switch (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!fpu_enabled)
+    return;
+
+  if (t == fpu_owner)
+    asm volatile ("clts");
+  else
+    write_cr0 (read_cr0 () | CR0_TS);
+}
+
+/* Frees the FPU state of thread T, which is exiting. */
+void
+fpu_release (struct thread *t)
+{
+  enum intr_level old_level;
+  void *area;
+
+  old_level = intr_disable ();
+  if (fpu_owner == t)
+    {
+      fpu_owner = NULL;
+      write_cr0 (read_cr0 () | CR0_TS);
+    }
+  area = t->fpu;
+  t->fpu = NULL;
+  intr_set_level (old_level);
+
+  free (area);
+}
+
+/* #NM handler.  Hands the FPU over to the current thread. */
+static void
+fpu_nm_handler (struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+
+  if (!fpu_enabled)
+    PANIC ("FPU instruction at %p without an FPU", f->eip);
+
+  /* First use of the FPU by this thread.  malloc() may sleep, and
+     other threads may take over the FPU meanwhile, so this comes
+     before touching any FPU state. */
+  if (cur->fpu == NULL)
+    {
+      void *area = malloc (FPU_AREA_SIZE + 15);
+      if (area == NULL)
+        {
+#ifdef USERPROG
+          if (f->cs != SEL_KCSEG)
+            exit_handler (-1);
+#endif
+          PANIC ("out of memory for FPU state");
+        }
+      cur->fpu = area;
+      memcpy (fpu_area (cur), &fpu_initial_state, sizeof fpu_initial_state);
+    }
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  asm volatile ("clts");
+  if (fpu_owner != cur)
+    {
+      if (fpu_owner != NULL)
+        fxsave (fpu_area (fpu_owner));
+      fxrstor (fpu_area (cur));
+      fpu_owner = cur;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+/* Size of the area FXSAVE stores the x87, MMX and SSE state in.
+   It must be 16-byte aligned. */
+#define FPU_AREA_SIZE 512
+
+void fpu_init (void);
+bool fpu_available (void);
+void fpu_switch (struct thread *);
+void fpu_release (struct thread *);
+
+#endif /* threads/fpu.h */
@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -105,7 +106,6 @@ main (void)
   paging_init ();
 
 #ifdef VM
-  swap_init ();
   page_init ();
 #endif /* ifdef VM */
 
@@ -117,6 +117,7 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  fpu_init ();
   timer_init ();
   kbd_init ();
   input_init ();
@@ -127,6 +128,7 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  intr_work_start ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -136,6 +138,10 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  /* Swap is sized from the swap device. */
+  swap_init ();
+#endif
 
   printf ("Boot complete.\n");
   is_boot_completed = true;
@@ -262,14 +268,29 @@ parse_options (char **argv)
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-evict"))
+        {
+          if (!page_set_evict_policy (value))
+            PANIC ("unknown eviction policy `%s' (use -h for help)", value);
+        }
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-tc"))
+        thread_page_cache_max = atoi (value);
+      else if (!strcmp (name, "-zp"))
+        palloc_zero_pct = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-rusage"))
+        process_print_rusage = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -390,8 +411,16 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -tc=COUNT          Cache up to COUNT freed thread pages (default 16).\n"
+#ifdef VM
+          "  -evict=POLICY      Evict frames by POLICY: fifo, clock (default),\n"
+          "                     or clock2 (two-handed clock).\n"
+#endif
+          "  -zp=PERCENT        Keep PERCENT of free pages zeroed (default 25).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -rusage            Print each process's resource usage on exit.\n"
 #endif
           );
   shutdown_power_off ();
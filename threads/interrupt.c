@@ -6,6 +6,7 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
@@ -47,6 +48,16 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Deferred work, queued by intr_defer(). */
+static struct list work_queue;          /* Pending struct intr_works. */
+static struct thread *work_thread;      /* Drains overflow, if started. */
+static bool work_thread_idle;           /* Is WORK_THREAD blocked? */
+
+/* Statistics. */
+static long long work_deferred;         /* # of intr_defer() that queued. */
+static long long work_intr_cnt;         /* # run on interrupt return. */
+static long long work_thread_cnt;       /* # run by WORK_THREAD. */
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -60,6 +71,10 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
 
+/* Deferred work helpers. */
+static bool run_work (void);
+static void work_thread_func (void *aux);
+
 /* Returns the current interrupt status. */
 enum intr_level
 intr_get_level (void) 
@@ -123,6 +138,8 @@ intr_init (void)
   /* Initialize interrupt controller. */
   pic_init ();
 
+  list_init (&work_queue);
+
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
     idt[i] = make_intr_gate (intr_stubs[i], 0);
@@ -224,6 +241,117 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* Initializes WORK to call FUNC, passing AUX, when deferred. */
+void
+intr_work_init (struct intr_work *work, intr_work_func *func, void *aux) 
+{
+  ASSERT (work != NULL);
+  ASSERT (func != NULL);
+
+  work->func = func;
+  work->aux = aux;
+  work->pending = false;
+}
+
+/* Queues WORK to run soon, outside the interrupt handler that
+   calls this function.  Returns true if WORK was queued, false
+   if it was already pending, in which case it still runs only
+   once.  WORK may defer itself again while it is running.  May
+   be called from any context. */
+bool
+intr_defer (struct intr_work *work) 
+{
+  enum intr_level old_level;
+  bool queued;
+
+  ASSERT (work != NULL);
+
+  old_level = intr_disable ();
+  queued = !work->pending;
+  if (queued) 
+    {
+      work->pending = true;
+      list_push_back (&work_queue, &work->elem);
+      work_deferred++;
+
+      /* Outside an interrupt, nothing else would notice. */
+      if (!in_external_intr && work_thread_idle) 
+        {
+          work_thread_idle = false;
+          thread_unblock (work_thread);
+        }
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Starts the thread that runs deferred work that did not fit in
+   the budget of an interrupt return.  Until it is started, such
+   work waits for the next external interrupt. */
+void
+intr_work_start (void) 
+{
+  struct semaphore started;
+
+  sema_init (&started, 0);
+  thread_create ("intr-work", PRI_MAX, work_thread_func, &started);
+  sema_down (&started);
+}
+
+/* Prints deferred work statistics. */
+void
+intr_print_stats (void) 
+{
+  printf ("Interrupts: %lld deferred work items, "
+          "%lld run on return, %lld by worker\n",
+          work_deferred, work_intr_cnt, work_thread_cnt);
+}
+
+/* Removes the first item from the work queue and runs it.
+   Returns false if the queue was empty.  Interrupts must be
+   off. */
+static bool
+run_work (void) 
+{
+  struct intr_work *work;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&work_queue))
+    return false;
+
+  work = list_entry (list_pop_front (&work_queue), struct intr_work, elem);
+  work->pending = false;
+  work->func (work->aux);
+  ASSERT (intr_get_level () == INTR_OFF);
+  return true;
+}
+
+/* Runs deferred work, one item at a time, giving interrupts a
+   chance to come in between items. */
+static void
+work_thread_func (void *started_) 
+{
+  struct semaphore *started = started_;
+
+  work_thread = thread_current ();
+  sema_up (started);
+
+  for (;;) 
+    {
+      intr_disable ();
+      if (run_work ())
+        work_thread_cnt++;
+      else 
+        {
+          work_thread_idle = true;
+          thread_block ();
+        }
+      intr_enable ();
+    }
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Initializes the PICs.  Refer to [8259A] for details.
@@ -358,6 +486,9 @@ intr_handler (struct intr_frame *frame)
 
       in_external_intr = true;
       yield_on_return = false;
+
+      /* Catch up on ticks missed in tickless idle. */
+      timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
@@ -376,9 +507,21 @@ intr_handler (struct intr_frame *frame)
   /* Complete the processing of an external interrupt. */
   if (external) 
     {
+      int budget;
+
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
+      /* Run a bounded amount of deferred work, still in interrupt
+         context, and hand the rest to the worker thread. */
+      for (budget = INTR_WORK_BUDGET; budget > 0 && run_work (); budget--)
+        work_intr_cnt++;
+      if (!list_empty (&work_queue) && work_thread_idle) 
+        {
+          work_thread_idle = false;
+          thread_unblock (work_thread);
+        }
+
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no); 
 
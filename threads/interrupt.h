@@ -1,6 +1,7 @@
 #ifndef THREADS_INTERRUPT_H
 #define THREADS_INTERRUPT_H
 
+#include <list.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -64,6 +65,34 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+/* Deferred work.
+
+   An external interrupt handler should do only what must be done
+   before the interrupt is acknowledged and queue the rest with
+   intr_defer().  Queued work runs, in FIFO order, just before the
+   interrupt returns, up to INTR_WORK_BUDGET items; whatever is
+   left is run by the "intr-work" kernel thread, which re-enables
+   interrupts between items.  Either way a work function runs with
+   interrupts off and must not sleep. */
+typedef void intr_work_func (void *aux);
+
+struct intr_work
+  {
+    struct list_elem elem;      /* Element in the work queue. */
+    intr_work_func *func;       /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Queued but not yet run? */
+  };
+
+/* Maximum number of work items run on return from one external
+   interrupt. */
+#define INTR_WORK_BUDGET 4
+
+void intr_work_init (struct intr_work *, intr_work_func *, void *aux);
+bool intr_defer (struct intr_work *);
+void intr_work_start (void);
+void intr_print_stats (void);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
@@ -7,8 +7,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <list.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +24,57 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**ORDER pages, aligned to their size relative to
+   the pool base, on one free list per order.  An allocation takes
+   a block of the smallest order that fits, splitting larger
+   blocks as needed, and gives back the pages it does not use.
+   Freeing a block merges it with its buddy, the other half of
+   the block of the next higher order, as long as the buddy is
+   free too.  Both take O(log n) time.
+
+   The free lists are threaded through the free pages themselves.
+   They are protected by disabling interrupts, not by a lock,
+   because pages are freed with interrupts off, for example by
+   thread_schedule_tail().
+
+   In addition, the idle thread keeps up to palloc_zero_pct
+   percent of each pool zeroed in advance, on a separate list, by
+   calling palloc_zero_idle().  Single-page PAL_ZERO requests are
+   served from that list first, which takes the memset() off the
+   page fault path.  Pre-zeroed pages go back to ordinary use when
+   the free blocks run out. */
+
+/* Percentage of each pool that the idle thread keeps zeroed.
+   Controlled by kernel command-line option "-zp=PERCENT". */
+int palloc_zero_pct = 25;
+
+/* Number of block orders.  The largest block is 2**15 pages. */
+#define ORDER_CNT 16
+
+/* In a pool's page_order, marks the first page of a free block.
+   The low bits hold the block's order. */
+#define BLOCK_FREE 0x80
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *page_order;                /* BLOCK_FREE | order, per page. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks, by order. */
+    size_t free_cnt[ORDER_CNT];         /* Number of blocks in each list. */
+    size_t free_pages;                  /* Total number of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Pre-zeroed pages, not counted in free_pages. */
+    struct list zeroed;                 /* Zeroed free pages. */
+    size_t zeroed_cnt;                  /* Pages zeroed or being zeroed. */
+    size_t zeroed_max;                  /* Most pages to keep zeroed. */
+    long long zero_requests;            /* # of single-page PAL_ZERO requests. */
+    long long zero_hits;                /* # served from ZEROED. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +83,14 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t take_block (struct pool *, int order);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t take_pages (struct pool *, size_t page_cnt);
+static size_t take_zeroed (struct pool *);
+static void release_zeroed (struct pool *);
+static bool zero_one (struct pool *);
+static void print_pool_stats (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,15 +123,44 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
-  size_t page_idx;
+  size_t page_idx = BITMAP_ERROR;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO)) 
+    {
+      pool->zero_requests++;
+      if (!list_empty (&pool->zeroed)) 
+        {
+          page_idx = take_zeroed (pool);
+          zeroed = true;
+          pool->zero_hits++;
+        }
+    }
+  if (page_idx == BITMAP_ERROR)
+    page_idx = take_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && !list_empty (&pool->zeroed)) 
+    {
+      /* Out of free blocks: fall back on the zeroed pages. */
+      if (page_cnt == 1) 
+        {
+          page_idx = take_zeroed (pool);
+          zeroed = true;
+        }
+      else 
+        {
+          release_zeroed (pool);
+          page_idx = take_pages (pool, page_cnt);
+        }
+    }
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,7 +169,7 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -118,6 +199,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -137,8 +219,12 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_range (pool, page_idx, page_cnt);
+  pool->free_pages += page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +234,36 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page for later PAL_ZERO requests, if a pool
+   has fewer than its share of zeroed pages.  Returns false if
+   there was nothing to do.  Called by the idle thread, with
+   interrupts on, so that the memset() can be preempted. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_one (&user_pool) || zero_one (&kernel_pool);
+}
+
+/* Prints the free memory and fragmentation of each pool. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and page_order at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +271,252 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->name = name;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->page_order = (uint8_t *) base + bm_size;
+  memset (p->page_order, 0, page_cnt);
+  for (order = 0; order < ORDER_CNT; order++) 
+    {
+      list_init (&p->free_lists[order]);
+      p->free_cnt[order] = 0;
+    }
   p->base = base + bm_pages * PGSIZE;
+
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt * palloc_zero_pct / 100;
+  p->zero_requests = p->zero_hits = 0;
+
+  /* Hand the whole pool to the buddy allocator. */
+  free_range (p, 0, page_cnt);
+  p->free_pages = page_cnt;
+}
+
+/* Removes PAGE_CNT contiguous pages from POOL's free blocks and
+   returns the index of the first, or BITMAP_ERROR if no free
+   block is large enough.  The part of the block beyond PAGE_CNT
+   pages is given back right away. */
+static size_t
+take_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx;
+  int order;
+
+  /* Smallest order that fits PAGE_CNT pages. */
+  for (order = 0; order < ORDER_CNT && ((size_t) 1 << order) < page_cnt;
+       order++)
+    continue;
+  if (order == ORDER_CNT)
+    return BITMAP_ERROR;
+
+  page_idx = take_block (pool, order);
+  if (page_idx != BITMAP_ERROR) 
+    {
+      free_range (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+      pool->free_pages -= page_cnt;
+    }
+  return page_idx;
+}
+
+/* Removes a page from POOL's nonempty list of zeroed pages and
+   returns its index.  The page is all zeros on return. */
+static size_t
+take_zeroed (struct pool *pool) 
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  e = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+  memset (e, 0, sizeof *e);
+  return ((uint8_t *) e - pool->base) / PGSIZE;
+}
+
+/* Gives all of POOL's zeroed pages back to the buddy allocator,
+   so that they can be merged into larger blocks. */
+static void
+release_zeroed (struct pool *pool) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&pool->zeroed)) 
+    {
+      struct list_elem *e = list_pop_front (&pool->zeroed);
+      free_block (pool, ((uint8_t *) e - pool->base) / PGSIZE, 0);
+      pool->zeroed_cnt--;
+      pool->free_pages++;
+    }
+}
+
+/* If POOL has fewer than zeroed_max zeroed pages, zeroes one
+   more and returns true.  Otherwise, or if POOL has no free page,
+   returns false. */
+static bool
+zero_one (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx = BITMAP_ERROR;
+  uint8_t *page;
+
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt < pool->zeroed_max)
+    page_idx = take_block (pool, 0);
+  if (page_idx != BITMAP_ERROR) 
+    {
+      pool->free_pages--;
+      pool->zeroed_cnt++;
+    }
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  page = pool->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_front (&pool->zeroed, (struct list_elem *) page);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns the free list element kept in the page at PAGE_IDX
+   of POOL. */
+static struct list_elem *
+block_elem (const struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page that holds ELEM in POOL. */
+static size_t
+elem_block (const struct pool *pool, struct list_elem *elem) 
+{
+  return ((uint8_t *) elem - pool->base) / PGSIZE;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, without merging it. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) 
+{
+  pool->page_order[page_idx] = BLOCK_FREE | order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+  pool->free_cnt[order]++;
+}
+
+/* Removes the free block of 2**ORDER pages at PAGE_IDX from
+   POOL's free lists. */
+static void
+remove_block (struct pool *pool, size_t page_idx, int order) 
+{
+  ASSERT (pool->page_order[page_idx] == (BLOCK_FREE | order));
+
+  pool->page_order[page_idx] = 0;
+  list_remove (block_elem (pool, page_idx));
+  pool->free_cnt[order]--;
+}
+
+/* Removes a free block of 2**ORDER pages from POOL and returns
+   the index of its first page, splitting the smallest larger
+   block if there is none of that order.  Returns BITMAP_ERROR
+   if no block is large enough. */
+static size_t
+take_block (struct pool *pool, int order) 
+{
+  size_t page_idx;
+  int k;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (k = order; k < ORDER_CNT; k++)
+    if (!list_empty (&pool->free_lists[k]))
+      break;
+  if (k == ORDER_CNT)
+    return BITMAP_ERROR;
+
+  page_idx = elem_block (pool, list_front (&pool->free_lists[k]));
+  remove_block (pool, page_idx, k);
+
+  /* Give back the upper half until the block is small enough. */
+  while (k > order) 
+    {
+      k--;
+      push_block (pool, page_idx + ((size_t) 1 << k), k);
+    }
+  return page_idx;
+}
+
+/* Returns the block of 2**ORDER pages at PAGE_IDX to POOL,
+   merging it with its buddy for as long as the buddy is a free
+   block of the same order. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (order < ORDER_CNT - 1) 
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy + ((size_t) 1 << order) > page_cnt
+          || pool->page_order[buddy] != (BLOCK_FREE | order))
+        break;
+
+      remove_block (pool, buddy, order);
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  push_block (pool, page_idx, order);
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL, as
+   the largest aligned blocks that cover them. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+      while (order < ORDER_CNT - 1
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Prints the free memory of POOL and its fragmentation, that is,
+   the percentage of free pages outside the largest free block. */
+static void
+print_pool_stats (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t free_pages, largest = 0;
+  int order;
+
+  old_level = intr_disable ();
+  free_pages = pool->free_pages + pool->zeroed_cnt;
+  for (order = ORDER_CNT - 1; order >= 0; order--)
+    if (pool->free_cnt[order] > 0) 
+      {
+        largest = (size_t) 1 << order;
+        break;
+      }
+  intr_set_level (old_level);
+
+  printf ("Palloc: %s: %zu of %zu pages free, largest block %zu pages, "
+          "%zu%% fragmented\n",
+          pool->name, free_pages, bitmap_size (pool->used_map), largest,
+          free_pages > 0 ? 100 - largest * 100 / free_pages : 0);
+  printf ("Palloc: %s: %lld of %lld zeroed page requests served "
+          "pre-zeroed, %zu pages ready\n",
+          pool->name, pool->zero_hits, pool->zero_requests,
+          pool->zeroed_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,213 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Object caches.
+
+   malloc() rounds every request up to a power of 2 and serves
+   all requests of that size from one shared descriptor.  An
+   object cache instead serves objects of a single type, at their
+   exact size, from pages of its own called "slabs".  Each slab
+   starts with a header and keeps a list of its free objects.
+   The cache keeps a list of its slabs that have a free object,
+   so both allocation and freeing take constant time.
+
+   A cache may have a constructor, which runs once per object,
+   when its slab is created, rather than on every allocation.
+   Objects of such a cache are not poisoned when they are freed,
+   and the free list link is kept after the object, not in it.
+
+   The lists are protected by disabling interrupts, which is
+   cheaper than a lock for such short critical sections and lets
+   objects be allocated and freed with interrupts off. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab1e55
+
+/* Slab header, at the start of the slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's partial list. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object, or null. */
+  };
+
+/* All caches, for kmem_print_stats(). */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *new_slab (struct kmem_cache *);
+
+/* Returns the free list link of object OBJ in CACHE. */
+static inline void **
+obj_link (const struct kmem_cache *cache, void *obj) 
+{
+  return (void **) ((uint8_t *) obj + cache->link_ofs);
+}
+
+/* Initializes CACHE to hand out objects of SIZE bytes, naming
+   it NAME for statistics.  If CTOR is nonnull, it is called on
+   every object when the object's slab is created. */
+void
+kmem_cache_init (struct kmem_cache *cache, const char *name, size_t size,
+                 kmem_ctor_func *ctor) 
+{
+  enum intr_level old_level;
+
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+
+  size = ROUND_UP (size, sizeof (void *));
+  cache->name = name;
+  cache->ctor = ctor;
+  cache->link_ofs = ctor != NULL ? size : 0;
+  cache->obj_size = ctor != NULL ? size + sizeof (void *) : size;
+  cache->objs_per_slab = (PGSIZE - sizeof (struct slab)) / cache->obj_size;
+  ASSERT (cache->objs_per_slab > 0);
+  list_init (&cache->partial);
+  cache->in_use = cache->peak = cache->slab_cnt = 0;
+  cache->alloc_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &cache->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns an object from CACHE, or a null pointer
+   if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache) 
+{
+  enum intr_level old_level;
+  struct slab *slab;
+  void *obj;
+
+  ASSERT (cache != NULL);
+
+  old_level = intr_disable ();
+  if (list_empty (&cache->partial)) 
+    {
+      /* Build the slab with interrupts as the caller had them,
+         since it runs the constructor on every object. */
+      intr_set_level (old_level);
+      slab = new_slab (cache);
+      if (slab == NULL)
+        return NULL;
+      intr_disable ();
+      list_push_front (&cache->partial, &slab->elem);
+      cache->slab_cnt++;
+    }
+
+  slab = list_entry (list_front (&cache->partial), struct slab, elem);
+  obj = slab->free;
+  slab->free = *obj_link (cache, obj);
+  if (--slab->free_cnt == 0)
+    list_remove (&slab->elem);
+
+  cache->alloc_cnt++;
+  if (++cache->in_use > cache->peak)
+    cache->peak = cache->in_use;
+  intr_set_level (old_level);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE, to
+   CACHE.  A slab that becomes entirely free is given back to the
+   page allocator, unless it is the only slab with free objects. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj) 
+{
+  enum intr_level old_level;
+  struct slab *slab;
+  bool release = false;
+
+  if (obj == NULL)
+    return;
+
+  slab = pg_round_down (obj);
+  ASSERT (slab->magic == SLAB_MAGIC);
+  ASSERT (slab->cache == cache);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  if (cache->ctor == NULL)
+    memset (obj, 0xcc, cache->obj_size);
+#endif
+
+  old_level = intr_disable ();
+  *obj_link (cache, obj) = slab->free;
+  slab->free = obj;
+  if (slab->free_cnt++ == 0)
+    list_push_front (&cache->partial, &slab->elem);
+  cache->in_use--;
+
+  if (slab->free_cnt == cache->objs_per_slab
+      && list_begin (&cache->partial) != list_rbegin (&cache->partial)) 
+    {
+      list_remove (&slab->elem);
+      cache->slab_cnt--;
+      slab->magic = 0;
+      release = true;
+    }
+  intr_set_level (old_level);
+
+  if (release)
+    palloc_free_page (slab);
+}
+
+/* Prints the usage of every object cache. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab: %s: %zu objects in use, peak %zu, %zu slabs, "
+              "%lld allocations\n",
+              c->name, c->in_use, c->peak, c->slab_cnt, c->alloc_cnt);
+    }
+}
+
+/* Obtains a page for a new slab of CACHE and fills it with
+   constructed, free objects.  Returns the slab, not yet on the
+   partial list, or a null pointer if memory is not available. */
+static struct slab *
+new_slab (struct kmem_cache *cache) 
+{
+  struct slab *slab;
+  uint8_t *obj;
+  size_t i;
+
+  slab = palloc_get_page (0);
+  if (slab == NULL)
+    return NULL;
+
+  slab->magic = SLAB_MAGIC;
+  slab->cache = cache;
+  slab->free_cnt = cache->objs_per_slab;
+  slab->free = NULL;
+
+  /* Link the objects from last to first, so that they are handed
+     out in address order. */
+  obj = (uint8_t *) (slab + 1) + cache->objs_per_slab * cache->obj_size;
+  for (i = 0; i < cache->objs_per_slab; i++) 
+    {
+      obj -= cache->obj_size;
+      if (cache->ctor != NULL)
+        cache->ctor (obj);
+      *obj_link (cache, obj) = slab->free;
+      slab->free = obj;
+    }
+  return slab;
+}
@@ -0,0 +1,36 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+
+/* Called on each object of a new slab, to put it into the state
+   in which kmem_cache_alloc() returns it.  Objects must be back
+   in that state when they are freed. */
+typedef void kmem_ctor_func (void *obj);
+
+/* A cache of objects of a single size. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Bytes per object, link included. */
+    size_t link_ofs;            /* Offset of free list link in object. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or a null pointer. */
+    struct list partial;        /* Slabs with at least one free object. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics. */
+    size_t in_use;              /* Objects allocated now. */
+    size_t peak;                /* Most objects ever allocated at once. */
+    size_t slab_cnt;            /* Slabs owned now. */
+    long long alloc_cnt;        /* Total number of allocations. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -31,8 +31,54 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
-#include "threads/init.h"
-#include "threads/malloc.h"
+#ifdef LOCKSTAT
+#include <lockstat.h>
+#include "devices/timer.h"
+
+/* Lock statistics, one record per lock_init() call site.  The
+   table is static, rather than linked through the locks, because
+   locks are often freed, with the structure they are part of,
+   without any notice. */
+struct lockstat_site
+  {
+    const char *file;           /* __FILE__ of lock_init() caller. */
+    int line;                   /* __LINE__ of lock_init() caller. */
+    struct lockstat stat;       /* Statistics.  `site' is unused. */
+  };
+
+/* Maximum number of call sites.  Locks from call sites beyond
+   this are all accounted to lockstat_other. */
+#define LOCKSTAT_SITE_CNT 128
+
+/* Number of sites in the table printed at shutdown. */
+#define LOCKSTAT_TOP_CNT 10
+
+static struct lockstat_site lockstat_sites[LOCKSTAT_SITE_CNT];
+static size_t lockstat_site_cnt;
+static struct lockstat_site lockstat_other = { .file = "(other)" };
+#endif
+
+static heap_less_func waiter_less_func;
+static heap_less_func cond_waiter_less_func;
+static void waiter_push (struct semaphore *, struct thread *);
+static struct thread *waiter_pop (struct semaphore *);
+static void lock_donate (struct lock *, struct thread *);
+static heap_action_func lock_revoke_donation;
+static heap_action_func lock_adopt_donation;
+static void lock_revoke_donations (struct lock *);
+static void lock_adopt_donations (struct lock *);
+static bool rwlock_can_read (struct rwlock *);
+static bool rwlock_can_write (struct rwlock *);
+static struct rwlock_hold *rwlock_find_hold (const struct rwlock *, struct thread *);
+static void rwlock_grant (struct rwlock *, bool write);
+static void rwlock_ungrant (struct rwlock *);
+static void rwlock_wake (struct rwlock *);
+static void rwlock_update_donations (struct rwlock *);
+static list_less_func rwlock_waiter_less;
+#ifdef LOCKSTAT
+static struct lockstat_site *lockstat_site (const char *file, int line);
+#endif
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -48,7 +94,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, waiter_less_func, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -69,7 +115,7 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_push_front (&sema->waiters, &thread_current ()->elem);
+      waiter_push (sema, thread_current ());
       thread_block ();
     }
   sema->value--;
@@ -116,17 +162,9 @@ sema_up (struct semaphore *sema)
   // increment sema value
   sema->value++;
 
-  // wake up a waiter
-  if (!list_empty (&sema->waiters)) {
-    // find thread with the highest priority
-    struct thread *next_waiter = list_entry (list_max (&sema->waiters, &thread_less_func, NULL), struct thread, elem);
-    
-    // remove from waiters list
-    list_remove (&next_waiter->elem);
-    
-    // complete wake up!
-    thread_unblock (next_waiter);
-  } 
+  // wake up the waiter with the highest priority
+  if (!heap_empty (&sema->waiters))
+    thread_unblock (waiter_pop (sema));
 
   intr_set_level (old_level);
 }
@@ -168,23 +206,107 @@ sema_test_helper (void *sema_)
     }
 }
 
-/* This function compares two semaphores (semaphore_elem) by the highest
- * priority in each waiter list.
- *
- * Its main purpose is to be used within cond_wait (). If it's not necessary,
- * do not use.
- * */
-bool
-sema_elem_less_func (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-  {
-    struct thread *thread_a = (list_entry(a, struct semaphore_elem, elem))->top_thread;
-    struct thread *thread_b = (list_entry(b, struct semaphore_elem, elem))->top_thread;
+/* Next arrival number for waiters.  It is only compared for
+   order between waiters, so wrapping around is harmless. */
+static unsigned waiter_seq;
 
-    ASSERT (thread_a != NULL);
-    ASSERT (thread_b != NULL);
+/* Returns true if a waiter with priority A_PRI that arrived at
+   A_SEQ must be woken up before one with B_PRI and B_SEQ. */
+static inline bool
+waiter_before (int a_pri, unsigned a_seq, int b_pri, unsigned b_seq)
+{
+  if (a_pri != b_pri)
+    return a_pri > b_pri;
+  return (int) (a_seq - b_seq) < 0;
+}
 
-    return thread_a->priority > thread_b->priority;
-  }
+/* Orders the threads waiting for a semaphore: highest effective
+   priority first, then first come first served. */
+static bool
+waiter_less_func (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, waitelem);
+  const struct thread *b = heap_entry (b_, struct thread, waitelem);
+
+  return waiter_before (a->effective_priority, a->wait_seq,
+                        b->effective_priority, b->wait_seq);
+}
+
+/* Orders the semaphore_elems waiting on a condition variable the
+   same way, by the priority of their threads. */
+static bool
+cond_waiter_less_func (const struct heap_elem *a_, const struct heap_elem *b_,
+                       void *aux UNUSED)
+{
+  const struct semaphore_elem *a = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b = heap_entry (b_, struct semaphore_elem, elem);
+
+  return waiter_before (a->top_thread->effective_priority, a->seq,
+                        b->top_thread->effective_priority, b->seq);
+}
+
+/* Adds T to SEMA's waiters. */
+static void
+waiter_push (struct semaphore *sema, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->wait_heap == NULL);
+
+  t->wait_seq = waiter_seq++;
+  t->wait_heap = &sema->waiters;
+  heap_push (&sema->waiters, &t->waitelem);
+}
+
+/* Removes and returns the highest-priority waiter of SEMA, which
+   must have one. */
+static struct thread *
+waiter_pop (struct semaphore *sema)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = heap_entry (heap_pop (&sema->waiters), struct thread, waitelem);
+  t->wait_heap = NULL;
+  return t;
+}
+
+/* Moves T within the waiter heaps it is in after its effective
+   priority changed, rising if RAISED is true and sinking
+   otherwise.  If T waits for a reader-writer lock, passes the
+   change along to the lock's holders.  Called by
+   thread_update_priority(). */
+void
+synch_reprioritize (struct thread *t, bool raised)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->wait_heap != NULL)
+    {
+      if (raised)
+        heap_decrease (t->wait_heap, &t->waitelem);
+      else
+        {
+          heap_remove (t->wait_heap, &t->waitelem);
+          heap_push (t->wait_heap, &t->waitelem);
+        }
+    }
+
+  if (t->cond_heap != NULL)
+    {
+      if (raised)
+        heap_decrease (t->cond_heap, t->cond_elem);
+      else
+        {
+          heap_remove (t->cond_heap, t->cond_elem);
+          heap_push (t->cond_heap, t->cond_elem);
+        }
+    }
+
+  if (t->waiting_for_rwlock != NULL)
+    rwlock_update_donations (t->waiting_for_rwlock);
+}
 
 /* Initializes LOCK.  A lock can be held by at most a single
    thread at any given time.  Our locks are not "recursive", that
@@ -200,20 +322,39 @@ sema_elem_less_func (const struct list_elem *a, const struct list_elem *b, void
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   With LOCKSTAT, lock_init() is a macro that passes along the
+   FILE and LINE of its caller, so that the statistics of LOCK
+   are filed under that call site. */
+#ifdef LOCKSTAT
+void
+lock_init_at (struct lock *lock, const char *file, int line)
+#else
 void
 lock_init (struct lock *lock)
+#endif
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCKSTAT
+  lock->site = lockstat_site (file, line);
+  lock->acquired_at = 0;
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While waiting, the current thread donates its priority to the
+   lock holder (see lock_donate()).  The semaphore is waited on
+   by hand, instead of with sema_down(), so that if another
+   thread grabs the lock between our wake up and our retry we
+   donate again to the new holder before going back to sleep.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -228,44 +369,110 @@ lock_acquire (struct lock *lock)
   ASSERT (cur->waiting_for_lock == NULL);
 
   enum intr_level old_level = intr_disable();
+#ifdef LOCKSTAT
+  int64_t wait_start = -1;
+#endif
 
   /* is lock available? */
-  if (!lock_try_acquire (lock)) {
-    /* donate priority to decrement waiting time. */
-    lock_donate_priority (lock, thread_get_priority ());
- 
+  while (!lock_try_acquire (lock)) {
+#ifdef LOCKSTAT
+    if (wait_start < 0)
+      wait_start = timer_ticks ();
+#endif
+
     /* start waiting... */
     cur->waiting_for_lock = lock;
 
-    sema_down (&lock->semaphore);
+    /* donate priority to decrement waiting time. MLFQS doesn't
+       use donation. */
+    if (!thread_mlfqs)
+      lock_donate (lock, cur);
 
-    /* set lock as mine */
-    lock->holder = cur;
+    waiter_push (&lock->semaphore, cur);
+    thread_block ();
   }
 
   /* mark thread as Not waiting */
   cur->waiting_for_lock = NULL;
 
+#ifdef LOCKSTAT
+  if (wait_start >= 0) {
+    struct lockstat *stat = &lock->site->stat;
+    int64_t waited = lock->acquired_at - wait_start;
+
+    stat->contended++;
+    stat->wait_ticks += waited;
+    if (waited > stat->max_wait_ticks)
+      stat->max_wait_ticks = waited;
+  }
+#endif
+
   intr_set_level(old_level);
 }
 
-void
-lock_donate_priority (struct lock *lock, int priority)
+/* Links the donation record of T, which is waiting for LOCK, into
+   the donation_list of LOCK's holder and updates the holder's
+   priority, and its own holder's, and so on. */
+static void
+lock_donate (struct lock *lock, struct thread *t)
 {
   ASSERT (lock != NULL);
-  ASSERT(lock->holder != NULL);
-  ASSERT(intr_get_level () == INTR_OFF);
+  ASSERT (lock->holder != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->donation.lock == NULL);
+
+  t->donation.lock = lock;
+  t->donation.priority = thread_calc_priority (t);
+  list_insert_ordered (&lock->holder->donation_list, &t->donation.elem,
+                       &donation_less_func, NULL);
+  thread_update_priority (lock->holder);
+}
 
-  struct lock *lock_i = lock;
-   do {
-    // donation
-    struct donation_list_elem *d_elem = malloc (sizeof (struct donation_list_elem)); 
-    d_elem->lock = lock_i;
-    d_elem->priority = priority; 
-    list_insert_ordered (&lock_i->holder->donation_list, &d_elem->elem, &donation_less_func, NULL);
+/* Unlinks the donation records of every thread waiting for LOCK
+   from the donation_list of LOCK's holder.  Only the donations
+   made through LOCK are touched. */
+static void
+lock_revoke_donations (struct lock *lock)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
 
-    lock_i = lock_i->holder->waiting_for_lock; 
-  } while (lock_i != NULL);
+  heap_apply (&lock->semaphore.waiters, lock_revoke_donation, lock);
+}
+
+/* heap_apply() action for lock_revoke_donations(). */
+static void
+lock_revoke_donation (struct heap_elem *e, void *lock)
+{
+  struct thread *t = heap_entry (e, struct thread, waitelem);
+
+  if (t->donation.lock == lock) {
+    list_remove (&t->donation.elem);
+    t->donation.lock = NULL;
+  }
+}
+
+/* Makes every thread still waiting for LOCK donate to its new
+   holder. */
+static void
+lock_adopt_donations (struct lock *lock)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  heap_apply (&lock->semaphore.waiters, lock_adopt_donation, lock);
+  thread_update_priority (lock->holder);
+}
+
+/* heap_apply() action for lock_adopt_donations(). */
+static void
+lock_adopt_donation (struct heap_elem *e, void *lock_)
+{
+  struct thread *t = heap_entry (e, struct thread, waitelem);
+  struct lock *lock = lock_;
+
+  t->donation.lock = lock;
+  t->donation.priority = thread_calc_priority (t);
+  list_insert_ordered (&lock->holder->donation_list, &t->donation.elem,
+                       &donation_less_func, NULL);
 }
 
 bool
@@ -279,25 +486,39 @@ donation_less_func (const struct list_elem *a, const struct list_elem *b, void *
 
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
-   thread.
+   thread.  Threads that are already waiting for LOCK start
+   donating to the current thread.
 
    This function will not sleep, so it may be called within an
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
-  if (success)
+  if (success) {
     lock->holder = thread_current ();
+#ifdef LOCKSTAT
+    lock->site->stat.acquisitions++;
+    lock->acquired_at = timer_ticks ();
+#endif
+    if (!thread_mlfqs && !heap_empty (&lock->semaphore.waiters))
+      lock_adopt_donations (lock);
+  }
+  intr_set_level (old_level);
+
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   The current thread gives back the priority donated through
+   LOCK; the threads still waiting donate to the next holder.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -313,18 +534,20 @@ lock_release (struct lock *lock)
 
   enum intr_level old_level = intr_disable ();
 
-  if (is_boot_completed) {
-    struct list *donation_list = &cur->donation_list;
-
-    struct list_elem *e;
-    for (e = list_begin (donation_list); e != list_end (donation_list); e = list_next (e)) {
-      struct donation_list_elem *d_elem = list_entry (e, struct donation_list_elem, elem); 
-      if (d_elem->lock == lock) {
-        list_remove (e);
-        e = e->prev;
-        free (d_elem);
-      }
-    }
+#ifdef LOCKSTAT
+  {
+    struct lockstat *stat = &lock->site->stat;
+    int64_t held = timer_ticks () - lock->acquired_at;
+
+    stat->hold_ticks += held;
+    if (held > stat->max_hold_ticks)
+      stat->max_hold_ticks = held;
+  }
+#endif
+
+  if (!heap_empty (&lock->semaphore.waiters)) {
+    lock_revoke_donations (lock);
+    thread_update_priority (cur);
   }
   
   lock->holder = NULL;
@@ -344,6 +567,320 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Initializes RWLOCK as a reader-writer lock that nobody
+   holds. */
+void
+rwlock_init (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  rwlock->readers = 0;
+  rwlock->writer = NULL;
+  list_init (&rwlock->read_waiters);
+  list_init (&rwlock->write_waiters);
+  list_init (&rwlock->holds);
+  rwlock->donated = PRI_MIN;
+}
+
+/* Acquires RWLOCK for shared access, sleeping while a writer
+   holds it or waits for it.  The current thread must not already
+   hold RWLOCK.  While waiting, the current thread donates its
+   priority to the writer holding RWLOCK, or to every reader
+   holding it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+  old_level = intr_disable ();
+  while (!rwlock_can_read (rwlock)) {
+    cur->waiting_for_rwlock = rwlock;
+    list_push_back (&rwlock->read_waiters, &cur->elem);
+    rwlock_update_donations (rwlock);
+    thread_block ();
+  }
+  cur->waiting_for_rwlock = NULL;
+  rwlock_grant (rwlock, false);
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RWLOCK for shared access without sleeping.
+   Returns true if successful, false otherwise.  The current
+   thread must not already hold RWLOCK. */
+bool
+rwlock_try_acquire_read (struct rwlock *rwlock)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+  old_level = intr_disable ();
+  success = rwlock_can_read (rwlock);
+  if (success)
+    rwlock_grant (rwlock, false);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RWLOCK, which the current thread must hold for shared
+   access.  The last reader out wakes up a waiting writer. */
+void
+rwlock_release_read (struct rwlock *rwlock)
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock->writer == NULL);
+  ASSERT (rwlock_held_by_current_thread (rwlock));
+
+  old_level = intr_disable ();
+  rwlock_ungrant (rwlock);
+  rwlock->readers--;
+  rwlock_wake (rwlock);
+  intr_set_level (old_level);
+}
+
+/* Acquires RWLOCK for exclusive access, sleeping while any
+   thread holds it.  The current thread must not already hold
+   RWLOCK.  While waiting, the current thread donates its
+   priority to every holder of RWLOCK.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+  old_level = intr_disable ();
+  /* rwlock_wake() hands RWLOCK over by making us its writer
+     before waking us up. */
+  while (rwlock->writer != cur && !rwlock_can_write (rwlock)) {
+    cur->waiting_for_rwlock = rwlock;
+    list_push_back (&rwlock->write_waiters, &cur->elem);
+    rwlock_update_donations (rwlock);
+    thread_block ();
+  }
+  cur->waiting_for_rwlock = NULL;
+  rwlock_grant (rwlock, true);
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RWLOCK for exclusive access without
+   sleeping.  Returns true if successful, false otherwise.  The
+   current thread must not already hold RWLOCK. */
+bool
+rwlock_try_acquire_write (struct rwlock *rwlock)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+  old_level = intr_disable ();
+  success = rwlock_can_write (rwlock);
+  if (success)
+    rwlock_grant (rwlock, true);
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   exclusive access.  Hands RWLOCK over to the highest-priority
+   waiting writer, the longest-waiting one among equals, if there
+   is one, and otherwise wakes up every waiting reader. */
+void
+rwlock_release_write (struct rwlock *rwlock)
+{
+  enum intr_level old_level;
+
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock->writer == thread_current ());
+
+  old_level = intr_disable ();
+  rwlock_ungrant (rwlock);
+  rwlock->writer = NULL;
+  rwlock_wake (rwlock);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RWLOCK, for either
+   shared or exclusive access, false otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  return rwlock_find_hold (rwlock, thread_current ()) != NULL;
+}
+
+/* Returns true if a new reader may acquire RWLOCK now. */
+static bool
+rwlock_can_read (struct rwlock *rwlock)
+{
+  return rwlock->writer == NULL && list_empty (&rwlock->write_waiters);
+}
+
+/* Returns true if a new writer may acquire RWLOCK now. */
+static bool
+rwlock_can_write (struct rwlock *rwlock)
+{
+  return rwlock->writer == NULL && rwlock->readers == 0;
+}
+
+/* Returns T's hold record for RWLOCK, or a null pointer if T
+   does not hold RWLOCK. */
+static struct rwlock_hold *
+rwlock_find_hold (const struct rwlock *rwlock, struct thread *t)
+{
+  int i;
+
+  for (i = 0; i < RWLOCK_HOLD_CNT; i++)
+    if (t->rwlock_holds[i].rwlock == rwlock)
+      return &t->rwlock_holds[i];
+  return NULL;
+}
+
+/* Makes the current thread a holder of RWLOCK, for exclusive
+   access if WRITE is true, shared access otherwise.  The current
+   thread starts receiving the donation of RWLOCK's waiters. */
+static void
+rwlock_grant (struct rwlock *rwlock, bool write)
+{
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = rwlock_find_hold (NULL, cur);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (hold != NULL);
+
+  hold->rwlock = rwlock;
+  hold->holder = cur;
+  list_push_back (&rwlock->holds, &hold->elem);
+
+  hold->donation.lock = NULL;
+  hold->donation.priority = rwlock->donated;
+  list_insert_ordered (&cur->donation_list, &hold->donation.elem,
+                       &donation_less_func, NULL);
+  thread_update_priority (cur);
+
+  if (write)
+    rwlock->writer = cur;
+  else
+    rwlock->readers++;
+}
+
+/* Drops the current thread's hold on RWLOCK, and with it the
+   donation received through RWLOCK. */
+static void
+rwlock_ungrant (struct rwlock *rwlock)
+{
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = rwlock_find_hold (rwlock, cur);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (hold != NULL);
+
+  list_remove (&hold->elem);
+  list_remove (&hold->donation.elem);
+  hold->rwlock = NULL;
+  thread_update_priority (cur);
+}
+
+/* Wakes up the threads that may now acquire RWLOCK, which has
+   just been released: a writer, preferably, once the last holder
+   is gone, or otherwise every waiting reader.  The writer is made
+   RWLOCK's writer right away, so that no reader can slip in
+   before it runs. */
+static void
+rwlock_wake (struct rwlock *rwlock)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&rwlock->write_waiters)) {
+    if (rwlock->readers == 0) {
+      struct list_elem *e = list_max (&rwlock->write_waiters,
+                                      rwlock_waiter_less, NULL);
+      struct thread *t = list_entry (e, struct thread, elem);
+
+      list_remove (e);
+      rwlock->writer = t;
+      thread_unblock (t);
+    }
+  } else {
+    while (!list_empty (&rwlock->read_waiters))
+      thread_unblock (list_entry (list_pop_front (&rwlock->read_waiters),
+                                  struct thread, elem));
+  }
+
+  rwlock_update_donations (rwlock);
+}
+
+/* Returns true if waiting thread A has a lower priority than
+   waiting thread B.  Being strict, it makes list_max() pick the
+   first of the waiters with the highest priority. */
+static bool
+rwlock_waiter_less (const struct list_elem *a, const struct list_elem *b,
+                    void *aux UNUSED)
+{
+  return (thread_calc_priority (list_entry (a, struct thread, elem))
+          < thread_calc_priority (list_entry (b, struct thread, elem)));
+}
+
+/* Recomputes the highest priority among RWLOCK's waiters and,
+   if it changed, passes it on to every holder of RWLOCK. */
+static void
+rwlock_update_donations (struct rwlock *rwlock)
+{
+  struct list *waiters[] = { &rwlock->read_waiters, &rwlock->write_waiters };
+  struct list_elem *e;
+  int donated = PRI_MIN;
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  for (i = 0; i < sizeof waiters / sizeof *waiters; i++)
+    for (e = list_begin (waiters[i]); e != list_end (waiters[i]); e = list_next (e)) {
+      int priority = thread_calc_priority (list_entry (e, struct thread, elem));
+      if (priority > donated)
+        donated = priority;
+    }
+
+  if (donated == rwlock->donated)
+    return;
+  rwlock->donated = donated;
+
+  for (e = list_begin (&rwlock->holds); e != list_end (&rwlock->holds); e = list_next (e)) {
+    struct rwlock_hold *hold = list_entry (e, struct rwlock_hold, elem);
+
+    list_remove (&hold->donation.elem);
+    hold->donation.priority = donated;
+    list_insert_ordered (&hold->holder->donation_list, &hold->donation.elem,
+                         &donation_less_func, NULL);
+    thread_update_priority (hold->holder);
+  }
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -352,7 +889,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less_func, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -378,7 +915,9 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -386,12 +925,17 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock)); /* current_thread owns the lock */
 
   sema_init (&waiter.semaphore, 0);
+  waiter.top_thread = cur;
 
-  // assing current thread to semaphore_elem for sorting purposes
-  waiter.top_thread =  thread_current ();
+  /* Donations may reposition us in COND's waiters at any time,
+     so the heap is only touched with interrupts off. */
+  old_level = intr_disable ();
+  waiter.seq = waiter_seq++;
+  cur->cond_elem = &waiter.elem;
+  cur->cond_heap = &cond->waiters;
+  heap_push (&cond->waiters, &waiter.elem);
+  intr_set_level (old_level);
 
-  // keep waiter list ordered
-  list_insert_ordered (&cond->waiters, &waiter.elem, &sema_elem_less_func, NULL);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -412,9 +956,14 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  enum intr_level old_level = intr_disable ();
+  if (!heap_empty (&cond->waiters)) {
+    struct semaphore_elem *waiter = heap_entry (heap_pop (&cond->waiters),
+                                                struct semaphore_elem, elem);
+    waiter->top_thread->cond_heap = NULL;
+    sema_up (&waiter->semaphore);
+  }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -429,6 +978,111 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+#ifdef LOCKSTAT
+/* Returns the statistics record for the lock_init() call at
+   FILE:LINE, creating it if needed, and counts one more lock
+   for it. */
+static struct lockstat_site *
+lockstat_site (const char *file, int line)
+{
+  struct lockstat_site *site;
+  enum intr_level old_level;
+  size_t i;
+
+  old_level = intr_disable ();
+  for (i = 0; i < lockstat_site_cnt; i++)
+    if (lockstat_sites[i].line == line && !strcmp (lockstat_sites[i].file, file))
+      break;
+  if (i < lockstat_site_cnt)
+    site = &lockstat_sites[i];
+  else if (lockstat_site_cnt < LOCKSTAT_SITE_CNT)
+    {
+      site = &lockstat_sites[lockstat_site_cnt++];
+      site->file = file;
+      site->line = line;
+    }
+  else
+    site = &lockstat_other;
+  site->stat.locks++;
+  intr_set_level (old_level);
+
+  return site;
+}
+
+/* Returns true if site A is more of a bottleneck than site B:
+   it saw more contended acquisitions, or as many but longer
+   waits, or as many of both but more acquisitions. */
+static bool
+lockstat_more (const struct lockstat *a, const struct lockstat *b)
+{
+  if (a->contended != b->contended)
+    return a->contended > b->contended;
+  if (a->wait_ticks != b->wait_ticks)
+    return a->wait_ticks > b->wait_ticks;
+  return a->acquisitions > b->acquisitions;
+}
+
+/* Stores in TOP the statistics of the CNT call sites whose locks
+   were contended the most, most contended first, and returns the
+   number stored, which is less than CNT if fewer sites exist. */
+size_t
+lockstat_top (struct lockstat *top, size_t cnt)
+{
+  enum intr_level old_level;
+  size_t top_cnt = 0;
+  size_t i;
+
+  old_level = intr_disable ();
+  for (i = 0; i <= lockstat_site_cnt; i++)
+    {
+      const struct lockstat_site *site = (i < lockstat_site_cnt
+                                          ? &lockstat_sites[i]
+                                          : &lockstat_other);
+      const char *file = site->file;
+      size_t pos = top_cnt;
+
+      if (site->stat.locks == 0)
+        continue;
+
+      /* Insertion into the sorted, bounded TOP array. */
+      while (pos > 0 && lockstat_more (&site->stat, &top[pos - 1]))
+        pos--;
+      if (pos >= cnt)
+        continue;
+      if (top_cnt < cnt)
+        top_cnt++;
+      memmove (&top[pos + 1], &top[pos], (top_cnt - pos - 1) * sizeof *top);
+
+      top[pos] = site->stat;
+      while (file[0] == '.' && file[1] == '.' && file[2] == '/')
+        file += 3;
+      snprintf (top[pos].site, sizeof top[pos].site, "%s:%d", file, site->line);
+    }
+  intr_set_level (old_level);
+
+  return top_cnt;
+}
+
+/* Prints the most contended lock call sites. */
+void
+lockstat_print_stats (void)
+{
+  static struct lockstat top[LOCKSTAT_TOP_CNT];
+  size_t cnt = lockstat_top (top, LOCKSTAT_TOP_CNT);
+  size_t i;
+
+  printf ("Lockstat: %zu call sites, top %zu by contention:\n",
+          lockstat_site_cnt, cnt);
+  printf ("  %-28s %5s %10s %9s %9s %6s %9s %6s\n", "site", "locks",
+          "acquired", "contended", "wait", "max", "held", "max");
+  for (i = 0; i < cnt; i++)
+    printf ("  %-28s %5u %10lld %9lld %9lld %6lld %9lld %6lld\n",
+            top[i].site, top[i].locks, top[i].acquisitions,
+            top[i].contended, top[i].wait_ticks, top[i].max_wait_ticks,
+            top[i].hold_ticks, top[i].max_hold_ticks);
+}
+#endif /* LOCKSTAT */
@@ -1,20 +1,27 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-/* A counting semaphore. */
+/* A counting semaphore.  Waiters are kept in a heap ordered by
+   effective priority, first come first served among equals, so
+   that sema_up() finds the next one in O(log n) and a donation
+   repositions a waiter in O(1) (see synch_reprioritize()). */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Heap of waiting threads. */
   };
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's waiters heap. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
-    struct thread *top_thread;          /* Keeps reference of top thread is semaphore for sorting purposes */
+    struct heap_elem elem;              /* Heap element. */
+    struct thread *top_thread;          /* Thread waiting on SEMAPHORE. */
+    unsigned seq;                       /* Arrival order, for ties. */
     struct semaphore semaphore;         /* This semaphore. */
   };
 
@@ -23,33 +30,89 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
-bool sema_elem_less_func (const struct list_elem *a, const struct list_elem *b, void *aux); 
+void synch_reprioritize (struct thread *, bool raised);
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+#ifdef LOCKSTAT
+    struct lockstat_site *site; /* Statistics of lock_init() call site. */
+    int64_t acquired_at;        /* Timer tick at last acquisition. */
+#endif
   };
-/* This struct alllows priority donations. See thread.h/struct thread/donation_list. */
 
+#ifdef LOCKSTAT
+/* Record which call site each lock comes from. */
+#define lock_init(LOCK) lock_init_at (LOCK, __FILE__, __LINE__)
+void lock_init_at (struct lock *, const char *file, int line);
+#else
 void lock_init (struct lock *);
+#endif
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
-void lock_donate_priority (struct lock*, int priority);
 
+/* This struct alllows priority donations. See thread.h/struct thread/donation_list.
+   A thread waits for at most one lock at a time, so each thread embeds
+   the only donation record it can ever need (struct thread's `donation'),
+   and donating never allocates memory. */
 struct donation_list_elem {
-  int priority;
-  struct lock *lock;
-  struct list_elem elem;
+  int priority;                 /* Donor's effective priority. */
+  struct lock *lock;            /* Lock donated through, NULL if not donating. */
+  struct list_elem elem;        /* Element in the holder's donation_list. */
 };
 bool donation_less_func (const struct list_elem *a, const struct list_elem *b, void *aux);
 
+/* Reader-writer lock.  Any number of readers, or a single
+   writer, may hold it at once.  Writers are preferred: once a
+   writer is waiting, new readers wait too, so that a steady
+   stream of readers cannot starve writers. */
+struct rwlock
+  {
+    unsigned readers;           /* # of threads holding it shared. */
+    struct thread *writer;      /* Thread holding it exclusively, or
+                                   handed it by rwlock_wake(), if any. */
+    struct list read_waiters;   /* Threads waiting for shared access. */
+    struct list write_waiters;  /* Threads waiting for exclusive access. */
+    struct list holds;          /* Holders' rwlock_hold records. */
+    int donated;                /* Highest priority among the waiters. */
+  };
+
+/* A thread's hold on a reader-writer lock.  It is also the record
+   through which the lock's waiters donate priority to the holder,
+   so unlike a lock, which has one holder, every reader receives
+   the donation.  Each thread embeds RWLOCK_HOLD_CNT of them. */
+struct rwlock_hold
+  {
+    struct rwlock *rwlock;              /* Held lock, NULL if unused. */
+    struct thread *holder;              /* Thread that holds RWLOCK. */
+    struct list_elem elem;              /* Element in RWLOCK's holds. */
+    struct donation_list_elem donation; /* Element in holder's donation_list. */
+  };
+
+/* Maximum number of reader-writer locks a thread can hold at once.
+   Hold records are embedded in struct thread because they are
+   taken with interrupts off, where nothing may be allocated.  The
+   kernel never nests more than two: open_inodes_lock and an
+   inode's rwlock, in filesys/inode.c.  Going over the limit is a
+   kernel bug, caught by an assertion in rwlock_grant(). */
+#define RWLOCK_HOLD_CNT 4
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Heap of semaphore_elems. */
   };
 
 void cond_init (struct condition *);
@@ -57,6 +120,12 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+#ifdef LOCKSTAT
+struct lockstat;
+size_t lockstat_top (struct lockstat *, size_t cnt);
+void lockstat_print_stats (void);
+#endif
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
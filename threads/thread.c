@@ -7,10 +7,12 @@
 #include "devices/timer.h"
 #include "list.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,21 +25,44 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes that are sleeping :)  */
-static struct list sleep_list;
+/* Processes that are sleeping :)  A min-heap keyed on
+   awake_on_ticks, so the timer interrupt only needs to look at
+   the earliest deadline. */
+static struct heap sleep_heap;
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority, and bit P of
+   ready_bitmap is set iff ready_queues[P] is not empty, so the
+   highest-priority ready thread is found with a bit scan. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* # of threads in the run queue. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* List a finished processes. Processes are added to this list
- * why process_exit () is called. Processes are removed from this
- * list when process_wait() is called. */
-static struct list dead_list;
+/* Number of buckets in tid_table and dead_table.  The tables
+   are updated with interrupts off, where hash_insert() and
+   hash_delete() must not be used because they may rehash and so
+   call malloc(), which can sleep.  Fixed bucket arrays never
+   allocate; tids are handed out sequentially, so TID % TID_BUCKETS
+   spreads them evenly. */
+#define TID_BUCKETS 64
+
+/* Threads in all_list, keyed by tid, so that thread_find()
+   does not have to walk all_list. */
+static struct list tid_table[TID_BUCKETS];
+
+/* Exit records of finished processes, keyed by tid.  Records are
+   added when process_exit() is called and removed when
+   process_wait() is called on them, or when the parent exits
+   without waiting, so there are never more of them than there
+   are finished children of live processes.  See struct
+   dead_thread. */
+static struct list dead_table[TID_BUCKETS];
+static struct kmem_cache dead_cache;    /* Allocates the records. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -45,6 +70,14 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Pages of dead threads, kept for reuse so that thread_create()
+   usually need not go through palloc nor zero a whole page.  A
+   cached page is linked through a list_elem at its base.  At most
+   thread_page_cache_max pages are kept; the rest are freed. */
+static struct list page_cache;
+static size_t page_cache_cnt;
+size_t thread_page_cache_max = 16;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
@@ -61,6 +94,10 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
+/* Thread page cache statistics. */
+static long long page_cache_hits;   /* # of pages reused from page_cache. */
+static long long page_cache_misses; /* # of pages obtained from palloc. */
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -70,6 +107,10 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* MLFQS system load average, an estimate of the number of
+   threads ready to run over the past minute. */
+static fixed_point load_avg;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -81,6 +122,20 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static heap_less_func sleep_less_func;
+static struct list *tid_bucket (struct list table[], tid_t);
+#ifdef USERPROG
+static void thread_reap_children (struct thread *);
+#endif
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_highest (void);
+static int mlfqs_calc_priority (struct thread *);
+static void mlfqs_update_priority (struct thread *, void *aux);
+static void mlfqs_update_recent_cpu (struct thread *, void *aux);
+static void mlfqs_update_load_avg (void);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -98,19 +153,32 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  size_t i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&sleep_list);
-  list_init (&ready_list);
+  heap_init (&sleep_heap, sleep_less_func, NULL);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  load_avg = 0;
   list_init (&all_list);
-  list_init (&dead_list);
+  list_init (&page_cache);
+  for (i = 0; i < TID_BUCKETS; i++)
+    {
+      list_init (&tid_table[i]);
+      list_init (&dead_table[i]);
+    }
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  list_push_back (tid_bucket (tid_table, initial_thread->tid),
+                  &initial_thread->tidelem);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -118,6 +186,9 @@ thread_init (void)
 void
 thread_start (void) 
 {
+  kmem_cache_init (&dead_cache, "dead_thread", sizeof (struct dead_thread),
+                   NULL);
+
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
@@ -137,32 +208,57 @@ void sleep_thread(int64_t ticks_to_sleep) {
   struct thread *curr_thread = thread_current ();
   curr_thread->awake_on_ticks = timer_ticks () + ticks_to_sleep;
 
-  /* remove current thread from ready_list  */
-  list_push_back (&sleep_list, &curr_thread->elem);
-  thread_block (); /* this function removes the thread from ready_list */
+  /* put current thread in sleep_heap  */
+  heap_push (&sleep_heap, &curr_thread->sleepelem);
+  thread_block (); /* this function removes the thread from the run queue */
 
   /* enable interruptions */
   intr_set_level (old_level);
 }
 
-/* Check if exists threads that must wake up :) */
-void
-awake_sleeping_thread (int64_t ticks)
+/* Wakes up threads whose deadline is TICKS or earlier :)
+   Only the earliest deadline is checked when nothing is due.  At
+   most MAX threads are woken; returns true if more are due. */
+bool
+awake_sleeping_thread (int64_t ticks, size_t max)
 {
-  struct list_elem *item = list_begin (&sleep_list); /* i_thread is like i in a for loop */
-  while (item != list_end (&sleep_list))
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!heap_empty (&sleep_heap))
   {
-    /* ? how does list_entry works?  */
-    struct thread *item_thread = list_entry (item, struct thread, elem);
-
-    if (ticks >= item_thread->awake_on_ticks) {
-      /* wake up thread */
-      item = list_remove (item); /* ? how does this functions works? */
-      thread_unblock (item_thread);
-    } else {
-      item = list_next (item);
-    }
+    struct thread *t = heap_entry (heap_min (&sleep_heap), struct thread, sleepelem);
+    if (t->awake_on_ticks > ticks)
+      break;
+    if (max-- == 0)
+      return true;
+
+    /* wake up thread */
+    heap_pop (&sleep_heap);
+    thread_unblock (t);
   }
+  return false;
+}
+
+/* Returns the tick at which the earliest sleeping thread must
+   wake up, or INT64_MAX if no thread is sleeping. */
+int64_t
+thread_next_wakeup (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (heap_empty (&sleep_heap))
+    return INT64_MAX;
+  return heap_entry (heap_min (&sleep_heap), struct thread, sleepelem)->awake_on_ticks;
+}
+
+/* Orders sleeping threads by wake up time, earliest first. */
+static bool
+sleep_less_func (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+  const struct thread *thread_a = heap_entry (a, struct thread, sleepelem);
+  const struct thread *thread_b = heap_entry (b, struct thread, sleepelem);
+
+  return thread_a->awake_on_ticks < thread_b->awake_on_ticks;
 }
 
 /* This function compares threads by their priority. When used in a
@@ -190,10 +286,38 @@ thread_tick (void)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->rusage.user_ticks++;
+    }
 #endif
   else
-    kernel_ticks++;
+    {
+      kernel_ticks++;
+      t->rusage.kernel_ticks++;
+    }
+
+  if (thread_mlfqs)
+    {
+      /* Only the running thread's recent_cpu changes on most
+         ticks, so only its priority needs recomputing.  Once per
+         second every thread's recent_cpu decays, and then every
+         priority is recomputed. */
+      int64_t now = timer_ticks ();
+
+      if (t != idle_thread)
+        t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+      if (now % TIMER_FREQ == 0)
+        {
+          mlfqs_update_load_avg ();
+          thread_foreach (mlfqs_update_recent_cpu, NULL);
+          if (thread_calc_priority (thread_top ()) > t->priority)
+            intr_yield_on_return ();
+        }
+      else if (now % TIME_SLICE == 0)
+        mlfqs_update_priority (t, NULL);
+    }
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -206,6 +330,9 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  printf ("Thread: %lld page cache hits, %lld misses\n",
+          page_cache_hits, page_cache_misses);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -231,12 +358,13 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -244,9 +372,13 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+  old_level = intr_disable ();
+  list_push_back (tid_bucket (tid_table, tid), &t->tidelem);
 #ifdef USERPROG
   t->parent = thread_current ();               /* set who will be my parent process */
+  list_push_back (&t->parent->children, &t->childelem);
 #endif /* ifdef USERPROG */
+  intr_set_level (old_level);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -276,59 +408,113 @@ thread_find (tid_t tid)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  struct thread *thread = NULL;
+  struct list *bucket = tid_bucket (tid_table, tid);
   struct list_elem *e;
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-           e = list_next (e))
-  {
-    thread = list_entry (e, struct thread, allelem);
-    if (thread->tid == tid)
-      return thread;
-  } 
 
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, tidelem);
+      if (t->tid == tid)
+        return t;
+    }
   return NULL;
 }
 
-/* Look up for tid in all finished threads. If the thread is not found, then 
- * NULL will be returned. */
+/* Look up for tid in the finished children of the running thread.
+ * If the thread is not found, then NULL will be returned.  The
+ * caller owns the returned record and must release it with
+ * thread_dead_free(). */
 struct dead_thread*
 thread_dead_pop (tid_t tid)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  struct dead_thread *thread = NULL;
+  struct list *bucket = tid_bucket (dead_table, tid);
   struct list_elem *e;
-  for (e = list_begin (&dead_list); e != list_end (&dead_list);
-           e = list_next (e))
-  {
-    thread = list_entry (e, struct dead_thread, elem);
-    if (thread->tid == tid) {
-      list_remove (e);                                             /* allows only one call to wait () per child. */
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct dead_thread *thread = list_entry (e, struct dead_thread, tidelem);
+      if (thread->tid != tid)
+        continue;
+      if (thread->parent != thread_current ()->tid)
+        return NULL;
+
+      list_remove (&thread->tidelem);                           /* allows only one call to wait () per child. */
+      list_remove (&thread->elem);
       return thread;
     }
-  } 
-
   return NULL;
 }
 
+/* Frees DT, a record returned by thread_dead_pop(). */
+void
+thread_dead_free (struct dead_thread *dt)
+{
+  kmem_cache_free (&dead_cache, dt);
+}
+
 #ifdef USERPROG
-/* Inserts a new dead thread entry to dead_list based in t. */
+/* Inserts a new exit record for t, so that its parent can wait
+   for it.  Nothing is recorded if t's parent has already exited. */
 bool thread_dead_push (struct thread *t) {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  struct dead_thread *dt = malloc (sizeof *dt);
+  if (t->parent == NULL)
+    return true;
+
+  struct dead_thread *dt = kmem_cache_alloc (&dead_cache);
   if (dt == NULL)
     return false;
 
   dt->tid = t->tid;
+  dt->parent = t->parent->tid;
   dt->exit_status = t->exit_status;
+  dt->rusage = t->rusage;
+  rusage_add (&dt->rusage, &t->child_rusage);
 
-  list_push_front (&dead_list, &dt->elem);
+  list_push_back (tid_bucket (dead_table, dt->tid), &dt->tidelem);
+  list_push_front (&t->parent->dead_children, &dt->elem);
 
   return true;
 }
+
+/* Detaches the exiting thread T from its parent and children.
+   Live children are orphaned, and the exit records of finished
+   children nobody can wait for any more are freed. */
+static void
+thread_reap_children (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->parent != NULL)
+    list_remove (&t->childelem);
+
+  while (!list_empty (&t->children))
+    {
+      struct thread *child = list_entry (list_pop_front (&t->children),
+                                         struct thread, childelem);
+      child->parent = NULL;
+    }
+
+  while (!list_empty (&t->dead_children))
+    {
+      struct dead_thread *dt = list_entry (list_pop_front (&t->dead_children),
+                                           struct dead_thread, elem);
+      list_remove (&dt->tidelem);
+      kmem_cache_free (&dead_cache, dt);
+    }
+}
 #endif /* ifdef USERPROG */
 
+/* Returns the bucket of TABLE, tid_table or dead_table, that
+   holds TID. */
+static struct list *
+tid_bucket (struct list table[], tid_t tid)
+{
+  return &table[(unsigned) tid % TID_BUCKETS];
+}
+
 /* Puts the current thread to sleep.  It will not be scheduled
    again until awoken by thread_unblock().
 
@@ -345,6 +531,24 @@ thread_block (void)
   schedule ();
 }
 
+/* Moves T to the run queue that matches its effective priority.
+   Must be called whenever a donation changes the priority of a
+   thread that may already be in the run queue; does nothing if
+   T is not ready or is already queued at the right priority. */
+void
+thread_requeue (struct thread *t)
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status != THREAD_READY
+      || t->ready_priority == thread_calc_priority (t))
+    return;
+
+  ready_remove (t);
+  ready_push (t);
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -364,8 +568,7 @@ thread_unblock (struct thread *t)
 
 #ifdef VM
   if (t->status == THREAD_BLOCKED) {
-    // ready_list must be ordered
-    list_insert_ordered (&ready_list, &t->elem, &thread_less_func, NULL);
+    ready_push (t);
     t->status = THREAD_READY;
   } else if (t->status == THREAD_EVICTION) {
     t->block_completed = true;
@@ -375,13 +578,16 @@ thread_unblock (struct thread *t)
 #else
   ASSERT (t->status == THREAD_BLOCKED);
 
-  // ready_list must be ordered
-  list_insert_ordered (&ready_list, &t->elem, &thread_less_func, NULL);
+  ready_push (t);
   t->status = THREAD_READY;
 
   if (thread_current () != idle_thread) {
     if (thread_calc_priority (t) > thread_calc_priority (thread_current ())) {
-      thread_yield ();
+      /* thread_yield () can't be called from the timer interrupt. */
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
     }
   }
 #endif /* ifdef VM */
@@ -432,12 +638,17 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  fpu_release (thread_current ());
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current ()->allelem);
+  list_remove (&thread_current ()->tidelem);
+#ifdef USERPROG
+  thread_reap_children (thread_current ());
+#endif
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -454,8 +665,8 @@ thread_yield (void)
   struct thread *cur = thread_current ();
 
   if (cur != idle_thread)
-    list_insert_ordered (&ready_list, &cur->elem, &thread_less_func, NULL); 
-  
+    ready_push (cur);
+
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -484,7 +695,14 @@ thread_set_priority (int new_priority)
 { 
   enum intr_level old_level = intr_disable ();
   struct thread *cur = thread_current ();
+  if (thread_mlfqs) {
+    /* priorities are computed by the scheduler. */
+    intr_set_level (old_level);
+    return;
+  }
+
   cur->priority = new_priority;
+  thread_update_priority (cur);
 
   if (thread_calc_priority (cur) < thread_calc_priority (thread_top ())) {
     thread_yield ();
@@ -493,25 +711,63 @@ thread_set_priority (int new_priority)
   intr_set_level (old_level);
 }
 
+/* Returns T's effective priority, that is, the highest of its
+   own priority and the priorities donated to it.  The value is
+   kept up to date by thread_update_priority(). */
 int
 thread_calc_priority (struct thread *t)
 {
-  ASSERT(t != NULL);
-  enum intr_level old_level = intr_disable ();
+  ASSERT (t != NULL);
 
-  if (!list_empty(&t->donation_list)) {
-    // debug
-    int highest_received_priority = list_entry(list_back(&t->donation_list), struct donation_list_elem, elem)->priority;
-    
-    if (t->priority <= highest_received_priority) {
-      intr_set_level (old_level);
-      return highest_received_priority;
-    }
-  }
+  return t->effective_priority;
+}
 
-  intr_set_level (old_level);
-  return t->priority;
+/* Recomputes T's effective priority from its own priority and
+   the highest donation in its donation_list.  If it changed,
+   moves T in the run queue and, if T is waiting for a lock,
+   passes the change along to the lock holder, and so on up the
+   chain of holders, stopping as soon as a priority is
+   unchanged.  A change in the priority of a thread waiting for a
+   reader-writer lock is passed along by synch_reprioritize(). */
+void
+thread_update_priority (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (t != NULL)
+    {
+      int priority = t->priority;
+      struct lock *lock = t->donation.lock;
+      bool raised;
+
+      if (!list_empty (&t->donation_list))
+        {
+          int donated = list_entry (list_back (&t->donation_list),
+                                    struct donation_list_elem, elem)->priority;
+          if (donated > priority)
+            priority = donated;
+        }
+
+      if (priority == t->effective_priority)
+        return;
+
+      raised = priority > t->effective_priority;
+      t->effective_priority = priority;
+      thread_requeue (t);
+      synch_reprioritize (t, raised);
+
+      if (lock == NULL)
+        return;
+
+      /* keep the holder's donation_list ordered. */
+      list_remove (&t->donation.elem);
+      t->donation.priority = priority;
+      list_insert_ordered (&lock->holder->donation_list, &t->donation.elem,
+                           &donation_less_func, NULL);
+      t = lock->holder;
+    }
 }
+
 /* Returns the current thread's priority. */
 int
 thread_get_priority (void) 
@@ -519,35 +775,116 @@ thread_get_priority (void)
   return thread_calc_priority (thread_current ());
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recalculates
+   its priority and yields if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  enum intr_level old_level = intr_disable ();
+  struct thread *cur = thread_current ();
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  cur->nice = nice;
+  if (thread_mlfqs) {
+    cur->priority = mlfqs_calc_priority (cur);
+    thread_update_priority (cur);
+    if (cur->priority < thread_calc_priority (thread_top ()))
+      thread_yield ();
+  }
+
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_to_int_round (load_avg * 100);
+  intr_set_level (old_level);
+
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fp_to_int_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+
+  return recent_cpu_100;
+}
+
+/* Returns T's MLFQS priority,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   range of priorities. */
+static int
+mlfqs_calc_priority (struct thread *t)
+{
+  int priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Recomputes T's MLFQS priority and, if T is ready, moves it to
+   the matching run queue.  The idle thread has no priority. */
+static void
+mlfqs_update_priority (struct thread *t, void *aux UNUSED)
+{
+  if (t == idle_thread)
+    return;
+
+  t->priority = mlfqs_calc_priority (t);
+  thread_update_priority (t);
+}
+
+/* Decays T's recent_cpu,
+   (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice,
+   and then recomputes its priority, which depends on it. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *aux UNUSED)
+{
+  fixed_point twice_load;
+
+  if (t == idle_thread)
+    return;
+
+  twice_load = load_avg * 2;
+  t->recent_cpu = fp_add_int (fp_mul (fp_div (twice_load,
+                                              fp_add_int (twice_load, 1)),
+                                      t->recent_cpu),
+                              t->nice);
+  mlfqs_update_priority (t, NULL);
+}
+
+/* Updates the load average,
+   (59 / 60) * load_avg + (1 / 60) * ready_threads,
+   where ready_threads counts the running thread and the threads
+   in the run queue, but never the idle thread. */
+static void
+mlfqs_update_load_avg (void)
+{
+  int ready_threads = ready_cnt;
+
+  if (thread_current () != idle_thread)
+    ready_threads++;
+
+  load_avg = (load_avg * 59 + fp_from_int (ready_threads)) / 60;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -572,6 +909,20 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Zero free pages for palloc while nothing else is ready.
+         Unblocking a thread does not preempt the idle thread, so
+         check the run queue again between pages. */
+      intr_enable ();
+      while (ready_bitmap == 0 && palloc_zero_idle ())
+        continue;
+      intr_disable ();
+      if (ready_bitmap != 0)
+        continue;
+
+      /* In tickless mode, stop the periodic timer until the next
+         sleeper is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -639,10 +990,25 @@ init_thread (struct thread *t, const char *name, int priority)
   
   /* init internal lists */
   t->waiting_for_lock = NULL;
+  t->waiting_for_rwlock = NULL;
+  t->donation.lock = NULL;
   list_init (&t->donation_list);
 
+  /* with MLFQS, children inherit the parent's niceness and
+     recent_cpu, and the priority argument is ignored. */
+  if (thread_mlfqs) {
+    struct thread *parent = running_thread ();
+    if (parent != t) {
+      t->nice = parent->nice;
+      t->recent_cpu = parent->recent_cpu;
+    }
+    t->priority = mlfqs_calc_priority (t);
+  }
+  t->effective_priority = t->priority;
+
 #ifdef VM
-  list_init (&t->page_table);
+  /* page_table stays empty until load() calls ptable_create(). */
+  rwlock_init (&t->page_table_lock);
   t->swap_deep = 0;
   t->block_completed = false;
 #endif /* ifdef VM */
@@ -652,6 +1018,8 @@ init_thread (struct thread *t, const char *name, int priority)
   t->allow_wait = true;
   sema_init(&t->wait_sema, 0);
   list_init(&t->fds);
+  list_init (&t->children);
+  list_init (&t->dead_children);
   /* actually my own exit status */
   t->exit_status = 0;
 #endif /* ifdef USERPROG */
@@ -684,23 +1052,76 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list)) {
+  if (ready_bitmap == 0) {
     return idle_thread;
   } else {
-    return list_entry (list_pop_back (&ready_list), struct thread, elem);
+    struct thread *t = list_entry (list_front (&ready_queues[ready_highest ()]),
+                                   struct thread, elem);
+    ready_remove (t);
+    return t;
   }
 }
 
 /* This function peeks the thread with the highest priority in
- * the ready_list. If you want to pop a thread use next_thread_to_run. */
+ * the run queue. If you want to pop a thread use next_thread_to_run. */
 struct thread *
 thread_top (void) {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  if (list_empty (&ready_list))
+  if (ready_bitmap == 0)
     return idle_thread;
   else
-    return list_entry (list_back (&ready_list), struct thread, elem);
+    return list_entry (list_front (&ready_queues[ready_highest ()]),
+                       struct thread, elem);
+}
+
+/* Appends T to the back of the run queue for its current
+   effective priority. */
+static void
+ready_push (struct thread *t)
+{
+  int priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  priority = thread_calc_priority (t);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  t->ready_priority = priority;
+  list_push_back (&ready_queues[priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << priority;
+  ready_cnt++;
+}
+
+/* Removes T from the run queue it was pushed onto. */
+static void
+ready_remove (struct thread *t)
+{
+  struct list *queue = &ready_queues[t->ready_priority];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  ready_cnt--;
+  if (list_empty (queue))
+    ready_bitmap &= ~((uint64_t) 1 << t->ready_priority);
+}
+
+/* Returns the highest priority with a non-empty run queue.
+   The run queue must not be empty.  The bitmap is scanned as
+   two 32-bit halves so that only `bsr' is needed. */
+static int
+ready_highest (void)
+{
+  uint32_t high = ready_bitmap >> 32;
+  uint32_t low = ready_bitmap;
+
+  ASSERT (ready_bitmap != 0);
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  else
+    return 31 - __builtin_clz (low);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -732,6 +1153,9 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Make the FPU trap unless it still holds our state. */
+  fpu_switch (cur);
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -745,10 +1169,56 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
+/* Returns a page for a new thread, with the part that holds
+   struct thread zeroed, or a null pointer if memory is
+   exhausted.  The rest of the page, the thread's stack, is not
+   cleared. */
+static struct thread *
+thread_page_get (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&page_cache))
+    {
+      t = (struct thread *) list_pop_front (&page_cache);
+      page_cache_cnt--;
+      page_cache_hits++;
+    }
+  else
+    page_cache_misses++;
+  intr_set_level (old_level);
+
+  if (t != NULL)
+    memset (t, 0, sizeof *t);
+  else
+    t = palloc_get_page (PAL_ZERO);
+  return t;
+}
+
+/* Releases the page of dead thread T, keeping it in page_cache
+   for reuse if there is room. */
+static void
+thread_page_put (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (page_cache_cnt < thread_page_cache_max)
+    {
+      /* Make stale pointers to T fail is_thread(). */
+      t->magic = 0;
+      list_push_front (&page_cache, (struct list_elem *) t);
+      page_cache_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -769,6 +1239,12 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next) {
+    /* A thread that is still ready was preempted; one that
+       blocked gave up the CPU itself. */
+    if (cur->status == THREAD_READY)
+      cur->rusage.involuntary_switches++;
+    else if (cur->status != THREAD_DYING)
+      cur->rusage.voluntary_switches++;
     prev = switch_threads (cur, next);
   }
   thread_schedule_tail (prev);
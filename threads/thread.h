@@ -3,9 +3,13 @@
 
 #include "threads/synch.h"
 #include <debug.h>
+#include <hash.h>
+#include <heap.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "../devices/timer.h"
+#include "threads/fixed-point.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -33,6 +37,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the MLFQS scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -96,19 +105,44 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Base priority. */
+    int effective_priority;             /* Priority including donations. */
+    int ready_priority;                 /* Run queue T is on, if ready. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tidelem;           /* Element in tid_table bucket. */
+
+    /* Owned by thread.c, MLFQS only. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recently used CPU time. */
 
     int64_t awake_on_ticks;             /* Ticks number when the thread must wake up.  */
+    struct heap_elem sleepelem;         /* Heap element for the sleepers heap. */
 
-    struct list donation_list;          /* Priority donations received. See /lib/kernel/list.h/donation_list_elem. */
+    struct list donation_list;          /* Priority donations received. See threads/synch.h/donation_list_elem. */
+    struct donation_list_elem donation; /* My donation to the holder of waiting_for_lock. */
     struct lock *waiting_for_lock;      /* If it's not NULL, this represents the lock I'm waiting for. */
+    struct rwlock *waiting_for_rwlock;  /* Reader-writer lock I'm waiting for, if any. */
+    struct rwlock_hold rwlock_holds[RWLOCK_HOLD_CNT]; /* Reader-writer locks I hold. */
+
+    /* Owned by threads/fpu.c. */
+    void *fpu;                          /* FXSAVE area, NULL until the FPU is used. */
+
+    /* Resource usage, updated by whoever uses the resource. */
+    struct rusage rusage;               /* This thread's own usage. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by synch.c. */
+    struct heap_elem waitelem;          /* Element in a semaphore's waiters. */
+    struct heap *wait_heap;             /* Semaphore waiters heap I'm in, or NULL. */
+    unsigned wait_seq;                  /* Arrival order in wait_heap. */
+    struct heap_elem *cond_elem;        /* My semaphore_elem in cond_heap. */
+    struct heap *cond_heap;             /* Condition waiters heap I'm in, or NULL. */
+
 #ifdef VM
-    struct list page_table;
+    struct hash page_table;             /* Supplementary page table. */
+    struct rwlock page_table_lock;      /* Guards page_table. */
 
     /* unused*/
     int swap_deep;
@@ -117,7 +151,11 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     struct file *f;                         /* File that is being execute */
-    struct thread *parent;
+    struct thread *parent;                  /* NULL once the parent exits. */
+    struct list children;                   /* Live child threads. */
+    struct list_elem childelem;             /* Element in parent's children. */
+    struct list dead_children;              /* Exit records of unwaited children. */
+    struct rusage child_rusage;             /* Usage of waited-for children. */
     uint32_t *pagedir;                      /* Page directory. */
 
     bool allow_wait;
@@ -131,11 +169,16 @@ struct thread
     unsigned magic;                     /* Detects stack overflow. */
   };
 
+/* Exit record of a finished process, kept until its parent
+   waits for it or exits. */
 struct dead_thread
   {
     tid_t tid;                          /* Thread identifier. */
+    tid_t parent;                       /* Parent's thread identifier. */
     uint32_t exit_status;               /* Exit status. */
-    struct list_elem elem;              /* List elem. */
+    struct rusage rusage;               /* Usage, its children's included. */
+    struct list_elem tidelem;           /* Element in dead_table bucket. */
+    struct list_elem elem;              /* Element in parent's dead_children. */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -143,10 +186,16 @@ struct dead_thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* Maximum number of pages of dead threads kept for reuse by
+   thread_create().  Controlled by kernel command-line option
+   "-tc=COUNT". */
+extern size_t thread_page_cache_max;
+
 void thread_init (void);
 void thread_start (void);
 void sleep_thread (int64_t ticks_to_sleep);
-void awake_sleeping_thread (int64_t ticks);
+bool awake_sleeping_thread (int64_t ticks, size_t max);
+int64_t thread_next_wakeup (void);
 void thread_tick (void);
 void thread_print_stats (void);
 
@@ -154,10 +203,12 @@ typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 struct thread *thread_find (tid_t tid);
 struct dead_thread* thread_dead_pop (tid_t tid);
+void thread_dead_free (struct dead_thread *);
 bool thread_dead_push (struct thread *t);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_requeue (struct thread *);
 
 struct thread *thread_top (void);
 struct thread *thread_current (void);
@@ -172,6 +223,7 @@ typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
 
 int thread_calc_priority (struct thread *t);
+void thread_update_priority (struct thread *t);
 int thread_get_priority (void);
 void thread_set_priority (int);
 
@@ -3,9 +3,11 @@
 #include <stdio.h>
 #include <string.h>
 #include "filesys/file.h"
+#include "threads/fpu.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/syscall.h"
@@ -60,8 +62,11 @@ exception_init (void)
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
   intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
-                     "#NM Device Not Available Exception");
+  /* #NM switches FPU state lazily if the CPU allows it; see
+     threads/fpu.c.  Otherwise user programs may not use the FPU. */
+  if (!fpu_available ())
+    intr_register_int (7, 0, INTR_ON, kill,
+                       "#NM Device Not Available Exception");
   intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
   intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
   intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -168,17 +173,22 @@ page_fault (struct intr_frame *f)
     lock_acquire (&page->evict);
     lock_release (&page->evict);
 
-    if (page->swap == NULL) {
+    if (page->swap_slot == SWAP_NONE) {
       switch (page->type) {
         case CODE:
+          thread_current ()->rusage.code_faults++;
           return page_fault_code (page);
           break;
 
         case STACK:
+          /* Growing the stack only creates the page; the
+             fault that retries the access counts it here. */
+          thread_current ()->rusage.stack_faults++;
           return page_fault_stack (page);
           break;
       }
     } else {
+      thread_current ()->rusage.swap_faults++;
       return page_fault_swap (page);
     }
   } else if (fault_addr < f->esp) {
@@ -245,7 +255,7 @@ void page_fault_stack (struct page *page) {
 void page_fault_swap (struct page *page) {
   ASSERT (pg_ofs(page->upage) == 0);
   ASSERT (page->kpage == NULL);
-  ASSERT (page->swap != NULL);
+  ASSERT (page->swap_slot != SWAP_NONE);
 
   /* reserve memory. */
   // page_block (page);
@@ -254,9 +264,16 @@ void page_fault_swap (struct page *page) {
   // lock_acquire (&evict_lock);
   // printf ("r:");
 
-  /* read from swap. */
-  swap_load (page->swap, page->kpage);
-  page->swap = NULL;
+  /* read from swap.  Keep the slot, so that evicting the page
+     while it is still clean costs no write, unless swap is
+     getting full.  Without a slot, the page must be written out
+     next time, so mark it dirty. */
+  swap_load (page->swap_slot, page->kpage);
+  if (swap_half_full ()) {
+    swap_free (page->swap_slot);
+    page->swap_slot = SWAP_NONE;
+    pagedir_set_dirty (page->owner->pagedir, page->upage, true);
+  }
 
   page_unblock (page);
 
@@ -24,6 +24,12 @@
 
 static thread_func start_process NO_RETURN;
 static bool load (struct filename_args *fn_args, void (**eip) (void), void **esp);
+static void print_rusage (struct thread *);
+
+/* If true, process_exit() prints each process's resource
+   usage after its termination message.  Controlled by kernel
+   command-line option "-rusage". */
+bool process_print_rusage;
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -150,7 +156,8 @@ process_wait (tid_t child_tid)
 
   /* finding an alive child process. */
   alive_child = thread_find (child_tid);                  /* find an alive child process. */
-  if (alive_child == NULL || !alive_child->allow_wait) {                             
+  if (alive_child == NULL || alive_child->parent != thread_current ()
+      || !alive_child->allow_wait) {                             
     dead_child = thread_dead_pop (child_tid);             /* find a dead child process. */
     if (dead_child == NULL) {
       intr_set_level (old_level);
@@ -159,9 +166,10 @@ process_wait (tid_t child_tid)
 
     /* get exit status. */
     exit_status = dead_child->exit_status;
+    rusage_add (&thread_current ()->child_rusage, &dead_child->rusage);
 
     /* free mem. */
-    free (dead_child);
+    thread_dead_free (dead_child);
 
     intr_set_level (old_level);
     return exit_status;
@@ -175,9 +183,10 @@ process_wait (tid_t child_tid)
                                                              status in threads/dead_list. */
   /* get exit status. */
   exit_status = dead_child->exit_status;
+  rusage_add (&thread_current ()->child_rusage, &dead_child->rusage);
 
   /* free mem. */
-  free (dead_child);
+  thread_dead_free (dead_child);
 
   intr_set_level (old_level);
   return exit_status;
@@ -192,6 +201,8 @@ process_exit (void)
 
   /* Process Termination Message */
   printf ("%s: exit(%d)\n", cur->name, cur->exit_status);
+  if (process_print_rusage)
+    print_rusage (cur);
 
   /* close source file. */
   if (cur->f != NULL) {
@@ -227,6 +238,24 @@ process_exit (void)
     }
 }
 
+/* Prints the resource usage of process T, its waited-for
+   children included. */
+static void
+print_rusage (struct thread *t) 
+{
+  struct rusage u = t->rusage;
+
+  rusage_add (&u, &t->child_rusage);
+  printf ("%s: rusage: %lld user ticks, %lld kernel ticks, "
+          "%lld voluntary and %lld involuntary switches\n",
+          t->name, u.user_ticks, u.kernel_ticks,
+          u.voluntary_switches, u.involuntary_switches);
+  printf ("%s: rusage: %lld code, %lld stack and %lld swap faults, "
+          "%lld bytes read, %lld bytes written\n",
+          t->name, u.code_faults, u.stack_faults, u.swap_faults,
+          u.bytes_read, u.bytes_written);
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -331,6 +360,10 @@ load (struct filename_args *fn_args, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!ptable_create ())
+    goto done;
+#endif
 
   filesys_acquire ();
 
@@ -14,4 +14,6 @@ tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+
+extern bool process_print_rusage;
 #endif /* userprog/process.h */
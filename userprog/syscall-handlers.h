@@ -16,5 +16,8 @@ void close_handler (int fd);
 void seek_handler (struct intr_frame *f);
 void tell_handler (struct intr_frame *f);
 void remove_handler (struct intr_frame *f);
+void lockstat_handler (struct intr_frame *f);
+void clock_handler (struct intr_frame *f);
+void rusage_handler (struct intr_frame *f);
 
 #endif // !SYSCALL_HANDLERS_H
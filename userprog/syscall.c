@@ -9,10 +9,16 @@
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/off_t.h"
 #include <syscall-nr.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef LOCKSTAT
+#include <lockstat.h>
+#endif
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "userprog/syscall-handlers.h"
 #include "vm/page.h"
 #include "vm/ptable.h"
@@ -27,6 +33,7 @@ struct fd_elem {
   struct thread *t;
   int fd;                               /* file descriptor. */
 };
+static struct kmem_cache fd_cache;      /* allocates fd_elems. */
 
 static void syscall_handler (struct intr_frame *f);
 
@@ -59,6 +66,7 @@ void syscall_init (void) {
   filesys_lock_deep = 0;
   lock_init (&filesys_lock);
   next_fd = 2;                          /* 0 and 1 are reserved form stdo and stdi. */
+  kmem_cache_init (&fd_cache, "fd_elem", sizeof (struct fd_elem), NULL);
 
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
@@ -126,6 +134,18 @@ syscall_handler (struct intr_frame *f)
       tell_handler (f);
       break;
 
+    case SYS_LOCKSTAT:
+      lockstat_handler (f);
+      break;
+
+    case SYS_CLOCK:
+      clock_handler (f);
+      break;
+
+    case SYS_RUSAGE:
+      rusage_handler (f);
+      break;
+
     default:
       printf ("system call %x !\n", sys_code);
       exit_handler (-1);                           /* thread_exit calls process_exit */
@@ -226,6 +246,9 @@ void write_handler (struct intr_frame *f)
       f->eax = -1;
     }
   }
+
+  if ((int) f->eax > 0)
+    thread_current ()->rusage.bytes_written += (int) f->eax;
 }
 
 void exit_handler (uint32_t exit_status) {
@@ -289,7 +312,7 @@ void open_handler (struct intr_frame *f) {
   filesys_release ();
 
   if (file != NULL) {
-    struct fd_elem *elem = malloc (sizeof (*elem));       /* reserve mem for file descriptor. */
+    struct fd_elem *elem = kmem_cache_alloc (&fd_cache);  /* reserve mem for file descriptor. */
     if (elem != NULL) {
       elem->file = file;
       elem->fd = next_fd++;
@@ -344,6 +367,9 @@ void read_handler (struct intr_frame *f) {
       f->eax = -1;
     }
   } 
+
+  if ((int) f->eax > 0)
+    thread_current ()->rusage.bytes_read += (int) f->eax;
 }
 
 void close_handler (int fd) {
@@ -354,7 +380,7 @@ void close_handler (int fd) {
     filesys_release ();
 
     list_remove (&fd_elem->elem);
-    free (fd_elem);
+    kmem_cache_free (&fd_cache, fd_elem);
   }
 }
 
@@ -385,3 +411,78 @@ void tell_handler (struct intr_frame *f) {
   }
 }
 
+/* Copies the statistics of up to CNT most contended lock call
+ * sites into the user buffer TOP, and returns how many were
+ * copied, or -1 if the kernel was built without LOCKSTAT. */
+void lockstat_handler (struct intr_frame *f) {
+#ifdef LOCKSTAT
+  struct lockstat *top = stack_ptr (f->esp, 1);
+  int cnt = stack_int (f->esp, 2);
+  struct lockstat *buffer;
+  size_t size;
+
+  if (cnt <= 0) {
+    f->eax = 0;
+    return;
+  }
+
+  /* the whole user buffer must be mapped. */
+  size = cnt * sizeof *top;
+  if (size / sizeof *top != (size_t) cnt
+      || !is_valid_addr ((uint8_t *) top + size - 1))
+    exit_handler (-1);
+  for (uint8_t *page = pg_round_up (top); page < (uint8_t *) top + size; page += PGSIZE)
+    if (!is_valid_addr (page))
+      exit_handler (-1);
+
+  buffer = malloc (size);
+  if (buffer == NULL) {
+    f->eax = -1;
+    return;
+  }
+  cnt = lockstat_top (buffer, cnt);
+  memcpy (top, buffer, cnt * sizeof *top);
+  free (buffer);
+
+  f->eax = cnt;
+#else
+  f->eax = -1;
+#endif
+}
+
+/* Returns the nanoseconds since boot in EDX:EAX. */
+void clock_handler (struct intr_frame *f) {
+  int64_t ns = timer_now_ns ();
+
+  f->eax = (uint32_t) ns;
+  f->edx = (uint64_t) ns >> 32;
+}
+
+/* Copies the resource usage of the calling process, or of its
+ * waited-for children if WHO is RUSAGE_CHILDREN, into USAGE.
+ * Returns 0 on success, -1 if WHO is invalid. */
+void rusage_handler (struct intr_frame *f) {
+  int who = stack_int (f->esp, 1);
+  struct rusage *usage = stack_ptr (f->esp, 2);
+  struct thread *cur = thread_current ();
+  struct rusage copy;
+
+  if (!is_valid_addr (usage) || !is_valid_addr ((uint8_t *) (usage + 1) - 1))
+    exit_handler (-1);
+
+  /* the timer interrupt updates the tick counts. */
+  enum intr_level old_level = intr_disable ();
+  if (who == RUSAGE_SELF)
+    copy = cur->rusage;
+  else if (who == RUSAGE_CHILDREN)
+    copy = cur->child_rusage;
+  else {
+    intr_set_level (old_level);
+    f->eax = -1;
+    return;
+  }
+  intr_set_level (old_level);
+
+  memcpy (usage, &copy, sizeof copy);
+  f->eax = 0;
+}
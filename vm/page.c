@@ -6,21 +6,73 @@
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
 #include "threads/interrupt.h"
+#include "vm/ptable.h"
 #include "vm/swap.h"
 #include <stdio.h>
+#include <string.h>
 
 /* list of virtual pages that are mapped to a memory frame. */
 struct list page_list;
 struct lock page_lock;
 struct lock evict_lock;
 
+/* How page_evict() chooses a victim.  Set by the kernel
+   command-line option "-evict=fifo|clock|clock2". */
+enum evict_policy page_evict_policy = EVICT_CLOCK;
+static const char *policy_names[] = { "fifo", "clock", "clock2" };
+
+/* The clock algorithms treat page_list as a circle.  CLOCK_HAND
+   points to the next frame to consider for eviction.  In the
+   two-handed variant, CLOCK_FRONT runs ahead of it, clearing
+   accessed bits, so that a frame is evicted if it has not been
+   used since the front hand passed it.  Both are null while
+   page_list is empty.  Guarded by page_lock. */
+static struct list_elem *clock_hand;
+static struct list_elem *clock_front;
+static size_t frame_cnt;                /* Number of pages in page_list. */
+
+/* Statistics. */
+static long long evict_cnt;             /* # of frames evicted. */
+static long long swap_write_cnt;        /* # of evictions written to swap. */
+static long long refault_cnt;           /* # of faults on evicted pages. */
+
 static bool install_page (void *upage, void *kpage, bool writable);
 static void* page_evict (void);
+static struct page *choose_victim (void);
+static struct list_elem *clock_next (struct list_elem *);
+static void clock_forget (struct list_elem *);
+static bool page_accessed (struct page *, bool clear);
 
 void page_init (void) {
   list_init (&page_list);       /* lista de paginas que SI estan en memoria fisica. */
   lock_init (&page_lock);       /* lock para modificar la page list. */
   lock_init (&evict_lock);      /* lock para eviction. */
+  ptable_init ();
+}
+
+/* Selects the eviction policy named NAME.  Returns false if there
+   is no such policy. */
+bool
+page_set_evict_policy (const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof policy_names / sizeof *policy_names; i++)
+    if (!strcmp (name, policy_names[i]))
+      {
+        page_evict_policy = i;
+        return true;
+      }
+  return false;
+}
+
+/* Prints eviction statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Evict: %s: %lld evictions, %lld swap writes, %lld refaults\n",
+          policy_names[page_evict_policy], evict_cnt, swap_write_cnt,
+          refault_cnt);
 }
 
 void
@@ -29,6 +81,12 @@ page_alloc (struct page *page)
   ASSERT (page->kpage == NULL);
   ASSERT (pg_ofs (page->upage) == 0);
 
+  if (page->evicted)
+    {
+      refault_cnt++;
+      page->evicted = false;
+    }
+
   /* try to alloc in easy way. */
   void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
 
@@ -54,7 +112,13 @@ void
 page_unblock (struct page *page)
 {
   lock_acquire (&page_lock);
-  list_push_back (&page_list, &page->allelem);
+  /* Behind the clock hand, the new frame is the last one the hand
+     reaches. */
+  if (clock_hand != NULL)
+    list_insert (clock_hand, &page->allelem);
+  else
+    list_push_back (&page_list, &page->allelem);
+  frame_cnt++;
   lock_release (&page_lock);
 }
 
@@ -63,10 +127,14 @@ page_evict (void)
 {
   lock_acquire (&evict_lock);
 
-  /* choose a page to evict. (FIFO) */
+  /* choose a page to evict. */
   lock_acquire (&page_lock);
-  struct page *page = list_entry (list_pop_front (&page_list), struct page, allelem);
+  struct page *page = choose_victim ();
+  clock_forget (&page->allelem);
+  list_remove (&page->allelem);
+  frame_cnt--;
   void *kpage = page->kpage;
+  evict_cnt++;
   lock_release (&page_lock);
 
   /* don't allow that thread to run. */
@@ -75,16 +143,22 @@ page_evict (void)
 
   enum intr_level old_level = intr_disable ();
   /* remove from page table (micro). */
+  bool dirty = pagedir_is_dirty (page->owner->pagedir, page->upage);
   pagedir_clear_page (page->owner->pagedir, page->upage);
   page->kpage = NULL;
   intr_set_level (old_level);
 
-  /* move to swap. */
-  if (page->is_writable) {
-    page->swap = swap_store (kpage, page->owner);
-  } else {
-    page->swap = NULL;
+  /* move to swap, unless the page is clean: then it still matches
+     its swap slot if it has one, or else its file data or zeros,
+     which page faults will read back. */
+  if (dirty) {
+    if (page->swap_slot != SWAP_NONE)
+      swap_write (page->swap_slot, kpage);
+    else
+      page->swap_slot = swap_store (kpage);
+    swap_write_cnt++;
   }
+  page->evicted = true;
 
   lock_release (&page->evict);
   lock_release (&evict_lock);
@@ -94,17 +168,110 @@ page_evict (void)
 
 void page_remove (struct page *page) {
   page_block (page);
-  if (page->swap != NULL)
-    swap_free_page (page->swap);
+  if (page->swap_slot != SWAP_NONE)
+    swap_free (page->swap_slot);
 }
 
 void page_block (struct page *page) {
   lock_acquire (&page_lock);
-  if (page->kpage != NULL)
+  if (page->kpage != NULL) {
+    clock_forget (&page->allelem);
     list_remove (&page->allelem);       /* page_list = fram_table */
+    frame_cnt--;
+  }
   lock_release (&page_lock);
 }
 
+/* Returns the page in page_list to evict, according to
+   page_evict_policy.  page_list must not be empty. */
+static struct page *
+choose_victim (void)
+{
+  struct page *page;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&page_lock));
+  ASSERT (!list_empty (&page_list));
+
+  if (page_evict_policy == EVICT_FIFO)
+    return list_entry (list_front (&page_list), struct page, allelem);
+
+  if (clock_hand == NULL)
+    clock_hand = list_begin (&page_list);
+
+  if (page_evict_policy == EVICT_CLOCK)
+    {
+      /* Give each recently used frame a second chance.  After one
+         full turn every bit is clear, unless processes running
+         meanwhile set them again; after two, take what comes. */
+      for (i = 0; ; i++)
+        {
+          page = list_entry (clock_hand, struct page, allelem);
+          clock_hand = clock_next (clock_hand);
+          if (!page_accessed (page, true) || i >= 2 * frame_cnt)
+            return page;
+        }
+    }
+
+  /* Two-handed clock.  Place the front hand a quarter of the
+     frames ahead of the back hand the first time around. */
+  if (clock_front == NULL)
+    {
+      clock_front = clock_hand;
+      for (i = 0; i < frame_cnt / 4; i++)
+        clock_front = clock_next (clock_front);
+    }
+  for (i = 0; ; i++)
+    {
+      page = list_entry (clock_hand, struct page, allelem);
+      page_accessed (list_entry (clock_front, struct page, allelem), true);
+      clock_front = clock_next (clock_front);
+      clock_hand = clock_next (clock_hand);
+
+      /* As above, give up waiting for an unused frame after two
+         full turns. */
+      if (!page_accessed (page, false) || i >= 2 * frame_cnt)
+        return page;
+    }
+}
+
+/* Returns the frame after E in page_list, wrapping around from
+   the end of the list to the beginning. */
+static struct list_elem *
+clock_next (struct list_elem *e)
+{
+  e = list_next (e);
+  return e != list_end (&page_list) ? e : list_begin (&page_list);
+}
+
+/* Moves any clock hand pointing at E, which is about to leave
+   page_list, to the next frame. */
+static void
+clock_forget (struct list_elem *e)
+{
+  struct list_elem *next = clock_next (e);
+
+  if (next == e)
+    next = NULL;                        /* E is the only frame. */
+  if (clock_hand == e)
+    clock_hand = next;
+  if (clock_front == e)
+    clock_front = next;
+}
+
+/* Returns whether PAGE's frame has been accessed by its owner
+   since the bit was last cleared, clearing the bit if CLEAR. */
+static bool
+page_accessed (struct page *page, bool clear)
+{
+  uint32_t *pd = page->owner->pagedir;
+  bool accessed = pagedir_is_accessed (pd, page->upage);
+
+  if (accessed && clear)
+    pagedir_set_accessed (pd, page->upage, false);
+  return accessed;
+}
+
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
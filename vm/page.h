@@ -5,11 +5,22 @@
 #include "filesys/off_t.h"
 #include "stdbool.h"
 #include "swap.h"
+#include "threads/synch.h"
 #include <stdint.h>
+#include <hash.h>
 #include <list.h>
 
 extern struct lock evict_lock;
 
+/* Frame eviction policies. */
+enum evict_policy {
+  EVICT_FIFO,               /* Oldest frame first. */
+  EVICT_CLOCK,              /* Second chance, one hand. */
+  EVICT_CLOCK2              /* Second chance, two hands. */
+};
+
+extern enum evict_policy page_evict_policy;
+
 enum page_type {
   CODE,
   STACK
@@ -21,23 +32,26 @@ struct page {
   void *kpage;              /* kernel page. */
   enum page_type type;
   bool is_writable;
+  bool evicted;             /* Evicted since last loaded? */
   struct lock evict;
 
   /* for page_list. Refer to page.h */
   struct list_elem allelem;             /* frame table. */
 
   /* for page table. */
-  struct list_elem elem;                /* suplementary page table. != page table micro */
+  struct hash_elem elem;                /* suplementary page table. != page table micro */
 
   /* code pages only. */
   off_t ofs;
   uint32_t read_bytes;
 
   /* swap. */
-  struct swap_page *swap;
+  size_t swap_slot;         /* Swap slot holding a copy, or SWAP_NONE. */
 };
 
 void page_init (void);
+bool page_set_evict_policy (const char *name);
+void page_print_stats (void);
 void page_alloc (struct page *page);      /* void * palloc_get_page (); */
 void page_unblock (struct page *page);              
 void page_remove (struct page *page);
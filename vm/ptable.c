@@ -1,11 +1,50 @@
 #include "ptable.h"
-#include "list.h"
+#include <hash.h>
 #include "page.h"
 #include "swap.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include <stdio.h>
+#include <string.h>
+
+/* The supplementary page table of each process is a hash table
+   of its struct pages keyed by user page number, so that page
+   faults and the user pointer checks in syscall.c find a page in
+   constant time however large the process is. */
+
+/* Allocates struct pages.  A page's evict lock is initialized
+   once, by page_ctor(), and is free whenever the page is. */
+static struct kmem_cache page_cache;
+
+static hash_hash_func page_hash_func;
+static hash_less_func page_less_func;
+static hash_action_func page_destroy;
+
+static void
+page_ctor (void *page_)
+{
+  struct page *page = page_;
+  lock_init (&page->evict);
+}
+
+void ptable_init (void) {
+  kmem_cache_init (&page_cache, "page", sizeof (struct page), page_ctor);
+}
+
+/* Creates the running process's supplementary page table.
+   Returns false if memory allocation fails, leaving the table
+   zeroed, as kernel threads have it, so that page_free_pages()
+   still finds nothing to free. */
+bool ptable_create (void) {
+  struct hash *table = &thread_current ()->page_table;
+
+  if (hash_init (table, page_hash_func, page_less_func, NULL))
+    return true;
+
+  memset (table, 0, sizeof *table);
+  return false;
+}
 
 struct page *page_create (void *upage, bool writable, enum page_type type) {
   ASSERT (pg_ofs (upage) == 0);
@@ -13,23 +52,30 @@ struct page *page_create (void *upage, bool writable, enum page_type type) {
   struct thread *cur = thread_current ();
 
   /* init page data. */
-  struct page *page = malloc (sizeof *page);
+  struct page *page = kmem_cache_alloc (&page_cache);
   if (page != NULL) {
+    struct hash_elem *old;
+
     page->owner = cur;
     page->upage = upage;
     page->kpage = NULL;
     page->type = type;              /* CODE || STACK */
     page->is_writable = writable;
-    lock_init (&page->evict);
+    page->evicted = false;
 
     /* type == CODE */
     page->ofs = 0;
     page->read_bytes = 0;
 
-    page->swap = NULL;
+    page->swap_slot = SWAP_NONE;
 
-    /* add to suplementary page table. */
-    list_push_front (&cur->page_table, &page->elem);
+    /* add to suplementary page table, replacing any older page
+       at UPAGE, as when two segments share a page. */
+    rwlock_acquire_write (&cur->page_table_lock);
+    old = hash_replace (&cur->page_table, &page->elem);
+    if (old != NULL)
+      page_destroy (old, NULL);
+    rwlock_release_write (&cur->page_table_lock);
 
     return page;
   } else {
@@ -42,16 +88,19 @@ struct page *page_find (void *upage) {
   ASSERT (pg_ofs(upage) == 0);
 
   struct thread *cur = thread_current ();
+  struct page key;
+  struct hash_elem *e;
 
-  for (struct list_elem *elem = list_begin (&cur->page_table); elem != list_end (&cur->page_table);
-       elem = list_next (elem)) {
-    struct page *page = list_entry (elem, struct page, elem);
+  /* Kernel threads never create a page table. */
+  if (hash_empty (&cur->page_table))
+    return NULL;
 
-    if (page->upage == upage)
-      return page;
-  }
+  key.upage = upage;
+  rwlock_acquire_read (&cur->page_table_lock);
+  e = hash_find (&cur->page_table, &key.elem);
+  rwlock_release_read (&cur->page_table_lock);
 
-  return NULL;
+  return e != NULL ? hash_entry (e, struct page, elem) : NULL;
 }
 
 
@@ -59,20 +108,39 @@ void page_free_pages (void) {
   struct thread *cur = thread_current ();
 
   lock_acquire (&evict_lock);
+  rwlock_acquire_write (&cur->page_table_lock);
 
-  for (struct list_elem *elem = list_begin (&cur->page_table); elem != list_end (&cur->page_table);
-       elem = list_next (elem)) {
-    struct page *page = list_entry (elem, struct page, elem);
+  /* remove every page from page_list(frame table) and swap, then
+     the table itself. */
+  hash_destroy (&cur->page_table, page_destroy);
 
-    /* remove from suplementary page table */
-    list_remove (elem);
-    elem = elem->prev;
+  rwlock_release_write (&cur->page_table_lock);
+  lock_release (&evict_lock);
+}
 
-    /* remove from page_list(frame table) and swap. */
-    page_remove (page);
-    free (page);
-  }
+/* Returns a hash value for page E's user page number. */
+static unsigned
+page_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (pg_no (hash_entry (e, struct page, elem)->upage));
+}
 
-  lock_release (&evict_lock);
+/* Returns true if page A's user page precedes page B's. */
+static bool
+page_less_func (const struct hash_elem *a, const struct hash_elem *b,
+                void *aux UNUSED)
+{
+  return (hash_entry (a, struct page, elem)->upage
+          < hash_entry (b, struct page, elem)->upage);
 }
 
+/* Releases the frame or swap slot of page E, which is no longer
+   in its supplementary page table, and frees it. */
+static void
+page_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *page = hash_entry (e, struct page, elem);
+
+  page_remove (page);
+  kmem_cache_free (&page_cache, page);
+}
@@ -3,6 +3,8 @@
 
 #include "page.h"
 
+void ptable_init (void);
+bool ptable_create (void);
 struct page *page_create (void *upage, bool writable, enum page_type type);
 struct page *page_find (void *upage);       /* suplementary page table. */
 void page_free_pages (void);
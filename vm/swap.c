@@ -1,88 +1,112 @@
 #include "vm/swap.h"
+#include <bitmap.h>
 #include <stdio.h>
-#include <list.h>
-#include "page.h"
+#include "devices/block.h"
 #include "threads/synch.h"
-#include "threads/malloc.h"
 #include "threads/vaddr.h"
-#include "userprog/syscall.h"
 
-#define SWAP_SIZE 1024               /* swap file size in PAGES. */
-#define SECTORS_PER_PAGE 8          /* swap file size in PAGES. */
-
-struct lock swap_lock;
-struct list swap_free;
-
-/* inits data needed for swap to work propertly. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* The swap device is divided into page-sized slots, tracked by
+   a bitmap with one bit per slot, set while the slot is in use.
+   Slots are handed out next-fit, from a cursor that moves
+   forward, so that pages evicted one after another land in
+   adjacent slots and their writes could be clustered.
+
+   Swap I/O goes straight to the block device and does not take
+   the file system lock: the swap device is not part of the file
+   system, and each slot belongs to a single page, whose evict
+   lock makes a fault wait for an eviction in progress before
+   reading the slot back.  The IDE driver's channel lock
+   serializes requests to the disk itself. */
+static struct block *swap_block;        /* Swap device, or NULL. */
+static struct bitmap *swap_map;         /* Slots in use. */
+static size_t swap_next;                /* Where to look for a free slot. */
+static struct lock swap_lock;           /* Guards the above. */
+
+/* Statistics. */
+static size_t swap_used;                /* # of slots in use. */
+static size_t swap_peak;                /* Most slots ever in use. */
+
+/* inits data needed for swap to work propertly.  Must run after
+ * the block devices are located. */
 void swap_init (void) {
-  /* the swap table is a list... */
-  list_init (&swap_free);
-  lock_init (&swap_lock);
-
-  /* registers how many blocks are available. */
-  for (block_sector_t i = 0; i < SWAP_SIZE; i ++) {
-    struct swap_page *page = malloc (sizeof *page);
+  size_t slot_cnt = 0;
 
-    /* initial data. */
-    page->sector = i * SECTORS_PER_PAGE;
-    page->owner = NULL; 
+  lock_init (&swap_lock);
+  swap_block = block_get_role (BLOCK_SWAP);
+  if (swap_block != NULL)
+    slot_cnt = block_size (swap_block) / SECTORS_PER_PAGE;
 
-    list_push_back (&swap_free, &page->elem);
-  }
+  swap_map = bitmap_create (slot_cnt);
+  if (swap_map == NULL)
+    PANIC ("swap_init: out of memory");
 }
 
-/* Stores PGSIZE bytes from kpage into the swap file. If the data
- * is stored returns true, false otherwise. */
-struct swap_page *swap_store (void *kpage, struct thread *owner) {
+/* Stores PGSIZE bytes from kpage into a free swap slot and
+ * returns the slot. */
+size_t swap_store (const void *kpage) {
   ASSERT (kpage != NULL);
   ASSERT (pg_ofs (kpage) == 0);
 
-  struct block *swap_block = block_get_role (BLOCK_SWAP);
-
-  /* finding an empty space in swap file.. */
+  /* finding an empty slot, after the last one handed out. */
   lock_acquire (&swap_lock);
-  struct list_elem *elem;
-  if (!list_empty (&swap_free))
-    elem = list_pop_front (&swap_free);
-  else
-    PANIC ("kernel bug - swap out of blocks.");
+  size_t slot = bitmap_scan_and_flip (swap_map, swap_next, 1, false);
+  if (slot == BITMAP_ERROR)
+    slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+  if (slot == BITMAP_ERROR)
+    PANIC ("swap: out of slots (%zu in use)", swap_used);
+  swap_next = slot + 1 < bitmap_size (swap_map) ? slot + 1 : 0;
+
+  swap_used++;
+  if (swap_used > swap_peak)
+    swap_peak = swap_used;
   lock_release (&swap_lock);
 
-  struct swap_page *swap = list_entry (elem, struct swap_page, elem);
-  swap->owner = owner;
+  swap_write (slot, kpage);
+  return slot;
+}
 
-  /* copy memory data. No synchronization needed. */
-  filesys_acquire ();
-  for (int i = 0; i < SECTORS_PER_PAGE; i++)
-    block_write (swap_block, swap->sector + i, kpage + i * BLOCK_SECTOR_SIZE);
-  filesys_release ();
+/* Overwrites SLOT with the PGSIZE bytes at KPAGE. */
+void swap_write (size_t slot, const void *kpage) {
+  ASSERT (slot < bitmap_size (swap_map));
+  ASSERT (kpage != NULL);
+  ASSERT (pg_ofs (kpage) == 0);
 
-  return swap;
+  block_sector_t sector = slot * SECTORS_PER_PAGE;
+  for (int i = 0; i < SECTORS_PER_PAGE; i++)
+    block_write (swap_block, sector + i, kpage + i * BLOCK_SECTOR_SIZE);
 }
 
-/* reads PGSIZE bytes FROM swap_file into MEM[kpage]. */
-void swap_load (struct swap_page *swap, void *kpage) {
-  ASSERT (swap != NULL);
+/* reads PGSIZE bytes FROM SLOT into MEM[kpage].  The slot stays
+ * allocated, as a copy of the page, until swap_free(). */
+void swap_load (size_t slot, void *kpage) {
+  ASSERT (slot < bitmap_size (swap_map));
   ASSERT (kpage != NULL);
   ASSERT (pg_ofs (kpage) == 0);
 
-  struct block *swap_block = block_get_role (BLOCK_SWAP);
-
-  filesys_acquire ();
-  for (int i = 0; i < SECTORS_PER_PAGE; i++) {
-    block_read (swap_block, swap->sector + i, kpage + i * BLOCK_SECTOR_SIZE);
-  }
-  filesys_release ();
+  block_sector_t sector = slot * SECTORS_PER_PAGE;
+  for (int i = 0; i < SECTORS_PER_PAGE; i++)
+    block_read (swap_block, sector + i, kpage + i * BLOCK_SECTOR_SIZE);
+}
 
-  /* mark sectors as free. */
-  swap_free_page (swap);
+/* Returns true if at least half of the swap slots are in use, in
+ * which case pages in memory should not hold on to their copies. */
+bool swap_half_full (void) {
+  return swap_used >= bitmap_size (swap_map) / 2;
 }
 
-void swap_free_page (struct swap_page *swap) {
-  /* mark sectors as free. */
+/* Marks SLOT as free. */
+void swap_free (size_t slot) {
   lock_acquire (&swap_lock);
-  swap->owner = NULL;
-  list_push_back (&swap_free, &swap->elem);
+  ASSERT (bitmap_test (swap_map, slot));
+  bitmap_reset (swap_map, slot);
+  swap_used--;
   lock_release (&swap_lock);
 }
 
+/* Prints swap usage statistics. */
+void swap_print_stats (void) {
+  printf ("Swap: %zu of %zu slots in use, peak %zu\n",
+          swap_used, bitmap_size (swap_map), swap_peak);
+}
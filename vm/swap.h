@@ -1,21 +1,21 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
-#include "devices/block.h"
-#include <list.h>
-#include "threads/thread.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-struct swap_page {
-  block_sector_t sector;            /* swap page pos. */
-  struct thread *owner;
-  struct list_elem elem;
-};
+/* Swap slot index of a page that has no copy in swap. */
+#define SWAP_NONE SIZE_MAX
 
 void swap_init (void);
 
-void swap_load (struct swap_page *entry, void *kpage);
-struct swap_page *swap_store (void *kpage, struct thread *owner);
+void swap_load (size_t slot, void *kpage);
+size_t swap_store (const void *kpage);
+void swap_write (size_t slot, const void *kpage);
+bool swap_half_full (void);
 
-void swap_free_page (struct swap_page *page);
+void swap_free (size_t slot);
+void swap_print_stats (void);
 
 #endif // !VM_SWAP_H